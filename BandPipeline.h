@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Конвейер по полосам строк. Первая стадия полосы b ни от кого не зависит,
+// вторая ждёт первую стадию полос b-1, b и b+1. У каждой полосы счётчик
+// оставшихся зависимостей: поток, обнуливший его, тут же выполняет вторую
+// стадию, пока строки соседних полос ещё в кэше. Вызывающий поток работает
+// наравне с помощниками, которые живут всё время жизни конвейера.
+class BandPipeline {
+public:
+    explicit BandPipeline(size_t threads) {
+        for (size_t i = 1; i < threads; ++i) {
+            helpers_.emplace_back([this] { helper(); });
+        }
+    }
+
+    BandPipeline(const BandPipeline&) = delete;
+    BandPipeline& operator=(const BandPipeline&) = delete;
+
+    ~BandPipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : helpers_) {
+            thread.join();
+        }
+    }
+
+    size_t threads() const { return helpers_.size() + 1; }
+
+    void run(size_t bands, std::function<void(size_t)> first, std::function<void(size_t)> second) {
+        if (bands > capacity_) {
+            pending_ = std::make_unique<std::atomic<int>[]>(bands);
+            capacity_ = bands;
+        }
+        for (size_t b = 0; b < bands; ++b) {
+            pending_[b].store((b > 0) + 1 + (b + 1 < bands), std::memory_order_relaxed);
+        }
+        first_ = std::move(first);
+        second_ = std::move(second);
+        bands_ = bands;
+        next_.store(0, std::memory_order_relaxed);
+        active_.store(helpers_.size(), std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        work();
+        for (size_t left; (left = active_.load(std::memory_order_acquire)) != 0;) {
+            active_.wait(left, std::memory_order_acquire);
+        }
+    }
+
+private:
+    void work() {
+        for (size_t b; (b = next_.fetch_add(1, std::memory_order_relaxed)) < bands_;) {
+            first_(b);
+            for (size_t k = b > 0 ? b - 1 : 0; k <= std::min(b + 1, bands_ - 1); ++k) {
+                if (pending_[k].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    second_(k);
+                }
+            }
+        }
+    }
+
+    void helper() {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            work();
+            if (active_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                active_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> helpers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    size_t generation_ = 0;
+    bool stop_ = false;
+
+    std::function<void(size_t)> first_, second_;
+    size_t bands_ = 0;
+    std::unique_ptr<std::atomic<int>[]> pending_;
+    size_t capacity_ = 0;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> active_{0};
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "FluidSimulator.h"
+
+struct BenchScenario {
+    std::string name;
+    double g;
+    double rho_air;
+    double rho_fluid;
+    std::vector<std::string> field;
+};
+
+struct BenchResult {
+    size_t ticks = 0;
+    uint64_t hash = 0;
+    double seconds = 0;
+};
+
+struct BenchTarget {
+    std::string name;
+    size_t n, m;
+    BenchResult (*run)(const SimulationConfig&);
+    bool (*check_batch)();
+};
+
+template<typename Sim>
+BenchResult run_bench_case(const SimulationConfig& config)
+{
+    auto simulator = std::make_unique<Sim>();
+    BenchResult result;
+    auto start = std::chrono::steady_clock::now();
+    result.ticks = simulator->run_simulation(config);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.hash = simulator->state_hash();
+    return result;
+}
+
+// Ядра fixed_batch против скалярных операторов на случайных сырых значениях.
+// Диапазон выбран так, чтобы ни сумма, ни произведение в расширенном типе не
+// переполнялись. add, multiply, маски и to_double должны совпасть бит в бит;
+// scale_by_reciprocal сравнивается с a[i] / d: в режиме проверок точно, иначе
+// с расхождением не больше единицы младшего разряда. Делители берутся по
+// модулю не меньше единицы, чтобы частное помещалось в тип. Для float и
+// double ядра — та же скалярная арифметика.
+template<typename T>
+bool batch_matches_scalar(std::mt19937_64& rng)
+{
+    if constexpr (!fixed_batch::traits<T>::is_fixed) {
+        return true;
+    } else {
+        using Traits = fixed_batch::traits<T>;
+        using Storage = typename T::StorageType;
+        constexpr size_t bits = std::min(Traits::storage_bits - 2, sizeof(typename Traits::Wide) * 4 - 1);
+        std::uniform_int_distribution<int64_t> raw(-(int64_t(1) << bits), int64_t(1) << bits);
+
+        constexpr size_t count = 4096;
+        std::vector<T> a(count), b(count), got(count);
+        for (size_t i = 0; i < count; ++i) {
+            a[i] = T::from_raw(static_cast<Storage>(raw(rng)));
+            b[i] = T::from_raw(static_cast<Storage>(raw(rng)));
+        }
+        a[count - 1] = b[0];
+        bool ok = true;
+        auto expect = [&](auto scalar) {
+            for (size_t i = 0; i < count; ++i) {
+                ok = ok && got[i].v == scalar(i).v;
+            }
+        };
+
+        got = a;
+        fixed_batch::add(std::span<T>(got), std::span<const T>(b));
+        expect([&](size_t i) { return a[i] + b[i]; });
+        got = a;
+        fixed_batch::add(std::span<T>(got), b[0]);
+        expect([&](size_t i) { return a[i] + b[0]; });
+        got = a;
+        fixed_batch::multiply(std::span<T>(got), std::span<const T>(b));
+        expect([&](size_t i) { return a[i] * b[i]; });
+        got = a;
+        fixed_batch::multiply(std::span<T>(got), b[0]);
+        expect([&](size_t i) { return a[i] * b[0]; });
+
+        std::uniform_int_distribution<int64_t> divisor_raw(int64_t(1) << Traits::frac_bits,
+                                                           int64_t(1) << (std::min<size_t>(Traits::storage_bits, 64) - 2));
+        for (size_t j = 0; j < 16; ++j) {
+            const int64_t raw_d = divisor_raw(rng);
+            const T d = T::from_raw(static_cast<Storage>(j % 2 ? -raw_d : raw_d));
+            got = a;
+            fixed_batch::scale_by_reciprocal(std::span<T>(got), d);
+            for (size_t i = 0; i < count; ++i) {
+                const int64_t diff = static_cast<int64_t>(got[i].v) - static_cast<int64_t>((a[i] / d).v);
+                ok = ok && (checked_arithmetic ? diff == 0 : diff >= -1 && diff <= 1);
+            }
+        }
+
+        std::vector<uint8_t> less(count), greater(count);
+        fixed_batch::mask_less(std::span<const T>(a), b[0], std::span<uint8_t>(less));
+        fixed_batch::mask_greater(std::span<const T>(a), b[0], std::span<uint8_t>(greater));
+        for (size_t i = 0; i < count; ++i) {
+            ok = ok && less[i] == (a[i] < b[0] ? 0xff : 0) && greater[i] == (a[i] > b[0] ? 0xff : 0);
+        }
+
+        std::vector<double> doubles(count);
+        fixed_batch::to_double(std::span<const T>(a), std::span<double>(doubles));
+        for (size_t i = 0; i < count; ++i) {
+            ok = ok && std::bit_cast<uint64_t>(doubles[i]) == std::bit_cast<uint64_t>(static_cast<double>(a[i]));
+        }
+        return ok;
+    }
+}
+
+template<typename P, typename V, typename F, size_t N, size_t M>
+bool check_batch_types()
+{
+    std::mt19937_64 rng(N * M);
+    return batch_matches_scalar<P>(rng) && batch_matches_scalar<V>(rng) && batch_matches_scalar<F>(rng);
+}
+
+inline std::vector<std::string> walled_field(size_t rows, size_t cols)
+{
+    std::vector<std::string> field(rows, std::string(cols, ' '));
+    for (size_t x = 0; x < rows; ++x) {
+        field[x][0] = field[x][cols - 1] = '#';
+    }
+    field[0] = field[rows - 1] = std::string(cols, '#');
+    return field;
+}
+
+// Открытый бак: столб жидкости у левой стенки на две трети высоты.
+inline std::vector<std::string> make_tank(size_t rows, size_t cols)
+{
+    auto field = walled_field(rows, cols);
+    for (size_t x = rows / 3; x + 1 < rows; ++x) {
+        for (size_t y = 1; y < std::max<size_t>(2, cols / 3); ++y) {
+            field[x][y] = '.';
+        }
+    }
+    return field;
+}
+
+// Змейка из горизонтальных перегородок с проходами у чередующихся стенок.
+inline std::vector<std::string> make_channels(size_t rows, size_t cols)
+{
+    auto field = walled_field(rows, cols);
+    bool gap_right = true;
+    for (size_t x = 4; x + 2 < rows; x += 4) {
+        for (size_t y = 1; y + 1 < cols; ++y) {
+            field[x][y] = '#';
+        }
+        field[x][gap_right ? cols - 2 : 1] = ' ';
+        gap_right = !gap_right;
+    }
+    for (size_t x = 1; x < std::min<size_t>(4, rows - 1); ++x) {
+        for (size_t y = 1; y + 1 < cols; ++y) {
+            field[x][y] = '.';
+        }
+    }
+    return field;
+}
+
+// Пористая среда: случайные препятствия с фиксированным зерном под слоем жидкости.
+inline std::vector<std::string> make_porous(size_t rows, size_t cols, unsigned seed)
+{
+    auto field = walled_field(rows, cols);
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution obstacle(0.2);
+    for (size_t x = 1; x + 1 < rows; ++x) {
+        for (size_t y = 1; y + 1 < cols; ++y) {
+            if (x <= rows / 4) {
+                field[x][y] = '.';
+            } else if (x > rows / 3 && obstacle(rng)) {
+                field[x][y] = '#';
+            }
+        }
+    }
+    return field;
+}
+
+inline std::vector<BenchScenario> bench_scenarios()
+{
+    const std::pair<size_t, size_t> sizes[] = {{14, 5}, {18, 30}, {36, 84}};
+    const std::pair<double, double> densities[] = {{0.01, 1000}, {1, 10}};
+
+    std::vector<BenchScenario> scenarios;
+    for (auto [rows, cols] : sizes) {
+        for (auto [rho_air, rho_fluid] : densities) {
+            std::ostringstream suffix;
+            suffix << "-" << rows << "x" << cols << "-rho" << rho_fluid / rho_air;
+            scenarios.push_back({"tank" + suffix.str(), 0.1, rho_air, rho_fluid, make_tank(rows, cols)});
+            scenarios.push_back({"channels" + suffix.str(), 0.1, rho_air, rho_fluid, make_channels(rows, cols)});
+            scenarios.push_back({"porous" + suffix.str(), 0.1, rho_air, rho_fluid, make_porous(rows, cols, 42)});
+        }
+    }
+    return scenarios;
+}
+
+inline std::string scenario_json(const BenchScenario& scenario)
+{
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"g\": " << scenario.g << ",\n";
+    json << "  \"rho\": {\n";
+    json << "    \" \": " << scenario.rho_air << ",\n";
+    json << "    \".\": " << scenario.rho_fluid << "\n";
+    json << "  },\n";
+    json << "  \"field\": [\n";
+    for (size_t i = 0; i < scenario.field.size(); ++i) {
+        json << "    \"" << scenario.field[i] << "\"";
+        if (i != scenario.field.size() - 1)
+            json << ",";
+        json << "\n";
+    }
+    json << "  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
+// Каждый случай считается в отдельном процессе: так пиковый RSS берётся из
+// wait4 именно для него, а зависший или упавший случай не ломает остальные.
+inline std::string run_bench_isolated(const BenchTarget& target, const SimulationConfig& config, unsigned timeout, bool timing)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return "error";
+    }
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        alarm(timeout);
+
+        BenchResult result = target.run(config);
+        char line[128];
+        int len = std::snprintf(line, sizeof(line), "%zu\t%016" PRIx64 "\t%.0f\n", result.ticks, result.hash,
+                                result.seconds > 0 ? result.ticks / result.seconds : 0.0);
+        if (write(fds[1], line, len) != len) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+
+    std::string reply;
+    char buffer[128];
+    ssize_t got;
+    while ((got = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        reply.append(buffer, got);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || reply.empty()) {
+        return WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM ? "timeout" : "crash";
+    }
+
+    reply.pop_back();
+    if (!timing) {
+        return reply.substr(0, reply.rfind('\t'));
+    }
+    return reply + "\t" + std::to_string(usage.ru_maxrss);
+}
+
+inline int run_benchmarks(const std::vector<BenchTarget>& targets, int argc, char* argv[])
+{
+    SimulationConfig config;
+    config.T = 100;
+    config.save_interval = 0;
+    config.verbose = false;
+    std::string output_file = "bench_results.tsv";
+    std::string filter;
+    unsigned timeout = 60;
+    bool timing = true;
+
+    // Число целиком, без хвоста и знака минус; иначе std::invalid_argument.
+    auto to_count = [](const std::string& text) {
+        size_t used = 0;
+        unsigned long value = std::stoul(text, &used);
+        if (used != text.size() || text.find('-') != std::string::npos) {
+            throw std::invalid_argument(text);
+        }
+        return value;
+    };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg.find("--ticks=") == 0) config.T = to_count(arg.substr(8));
+            else if (arg.find("--seed=") == 0) config.seed = to_count(arg.substr(7));
+            else if (arg.find("--output=") == 0) output_file = arg.substr(9);
+            else if (arg.find("--filter=") == 0) filter = arg.substr(9);
+            else if (arg.find("--timeout=") == 0) timeout = to_count(arg.substr(10));
+            else if (arg == "--no-timing") timing = false;
+        } catch (const std::exception&) {
+            std::cerr << "Неверное значение параметра: " << arg << "\n"
+                      << "Использование: fluid_bench [--ticks=T] [--seed=S] [--output=path] [--filter=строка] [--timeout=S] [--no-timing]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream output(output_file);
+    if (!output.is_open()) {
+        std::cerr << "Не удалось открыть файл для записи: " << output_file << std::endl;
+        return 1;
+    }
+    output << "# scenario\ttypes\tticks\tstate_hash";
+    if (timing) {
+        output << "\tticks_per_s\tpeak_rss_kb";
+    }
+    output << "\n";
+
+    int status = 0;
+    for (const auto& target : targets) {
+        std::string line = "batch-kernels\t" + target.name;
+        if (!filter.empty() && line.find(filter) == std::string::npos) {
+            continue;
+        }
+        bool ok = target.check_batch();
+        status |= !ok;
+        line += ok ? "\tok" : "\tmismatch";
+        output << line << "\n";
+        std::cout << line << std::endl;
+    }
+
+    for (const auto& scenario : bench_scenarios()) {
+        config.input_text = scenario_json(scenario);
+        for (const auto& target : targets) {
+            if (scenario.field.size() > target.n || scenario.field[0].size() > target.m) {
+                continue;
+            }
+            std::string line = scenario.name + "\t" + target.name;
+            if (!filter.empty() && line.find(filter) == std::string::npos) {
+                continue;
+            }
+            line += "\t" + run_bench_isolated(target, config, timeout, timing);
+            output << line << "\n";
+            std::cout << line << std::endl;
+        }
+    }
+    return status;
+}
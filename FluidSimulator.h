@@ -10,8 +10,26 @@
 #include <cstring>
 #include <ostream>
 #include <fstream> 
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include "fixed.h"
+#include "BandPipeline.h"
+#include "FrameRing.h"
+#include "Generator.h"
+#include "SlabExchange.h"
+#include "SnapshotCodec.h"
+#include "StateHistory.h"
 
 constexpr std::array<std::pair<int, int>, 4> deltas{{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
 
@@ -31,46 +49,392 @@ struct VectorField {
     }
 };
 
+// Представление двумерного массива без копирования, аналог std::mdspan с
+// layout_stride: шаги по строкам и столбцам заданы в элементах.
+template<typename T>
+struct GridView {
+    T* data = nullptr;
+    size_t rows = 0, cols = 0;
+    size_t row_stride = 0, col_stride = 1;
+
+    T& operator()(size_t x, size_t y) const { return data[x * row_stride + y * col_stride]; }
+    size_t extent(size_t dim) const { return dim == 0 ? rows : cols; }
+
+    std::span<T> row(size_t x) const {
+        assert(col_stride == 1);
+        return {data + x * row_stride, cols};
+    }
+};
+
+#ifdef FLUID_COMPACT_STATE
+constexpr bool compact_state = true;
+#else
+constexpr bool compact_state = false;
+#endif
+
+// Типы клеток хранятся прямо в симуляторе: по байту на клетку или, в
+// компактном режиме, по 2 бита с палитрой из четырёх символов.
+template<size_t N, size_t M, bool Packed = false>
+class CellGrid {
+public:
+    static constexpr size_t row_bytes = M;
+
+    template<typename Cell>
+    struct Row {
+        Cell* cells;
+        size_t cols;
+
+        Cell& operator[](size_t y) const { return cells[y]; }
+        size_t size() const { return cols; }
+
+        friend std::ostream& operator<<(std::ostream& os, const Row& row) {
+            return os.write(row.cells, row.cols);
+        }
+    };
+
+    bool push_back(const std::string& line) {
+        if (rows_ == N || line.size() > M) {
+            return false;
+        }
+        std::memcpy(cells_[rows_++], line.data(), line.size());
+        cols_ = std::max(cols_, line.size());
+        return true;
+    }
+
+    size_t size() const { return rows_; }
+    Row<char> operator[](size_t x) { return {cells_[x], cols_}; }
+    Row<const char> operator[](size_t x) const { return {cells_[x], cols_}; }
+    char* row_data(size_t x) { return reinterpret_cast<char*>(cells_[x]); }
+
+private:
+    char cells_[N][M]{};
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+};
+
+template<size_t N, size_t M>
+class CellGrid<N, M, true> {
+public:
+    static constexpr size_t row_bytes = (M + 3) / 4;
+
+    class CellRef {
+    public:
+        CellRef(CellGrid* grid, size_t x, size_t y) : grid_(grid), x_(x), y_(y) {}
+
+        operator char() const { return grid_->get(x_, y_); }
+
+        CellRef& operator=(char c) {
+            grid_->set(x_, y_, c);
+            return *this;
+        }
+
+        CellRef& operator=(const CellRef& other) {
+            return *this = static_cast<char>(other);
+        }
+
+    private:
+        CellGrid* grid_;
+        size_t x_, y_;
+    };
+
+    template<typename Grid>
+    struct Row {
+        Grid* grid;
+        size_t x;
+
+        auto operator[](size_t y) const {
+            if constexpr (std::is_const_v<Grid>) {
+                return grid->get(x, y);
+            } else {
+                return CellRef(grid, x, y);
+            }
+        }
+        size_t size() const { return grid->cols_; }
+
+        friend std::ostream& operator<<(std::ostream& os, const Row& row) {
+            for (size_t y = 0; y < row.size(); ++y) {
+                os << row.grid->get(row.x, y);
+            }
+            return os;
+        }
+    };
+
+    bool push_back(const std::string& line) {
+        if (rows_ == N || line.size() > M) {
+            return false;
+        }
+        for (size_t y = 0; y < line.size(); ++y) {
+            if (code(line[y]) == palette_size) {
+                return false;
+            }
+            set(rows_, y, line[y]);
+        }
+        cols_ = std::max(cols_, line.size());
+        ++rows_;
+        return true;
+    }
+
+    size_t size() const { return rows_; }
+    Row<CellGrid> operator[](size_t x) { return {this, x}; }
+    Row<const CellGrid> operator[](size_t x) const { return {this, x}; }
+    char* row_data(size_t x) { return reinterpret_cast<char*>(bits_[x]); }
+
+    char get(size_t x, size_t y) const {
+        return palette_[(bits_[x][y / 4] >> (y % 4 * 2)) & 3];
+    }
+
+    void set(size_t x, size_t y, char c) {
+        uint8_t bits = code(c);
+        assert(bits < palette_size);
+        uint8_t shift = y % 4 * 2;
+        uint8_t& byte = bits_[x][y / 4];
+        byte = static_cast<uint8_t>((byte & ~(3 << shift)) | (bits << shift));
+    }
+
+private:
+    static constexpr uint8_t palette_size = 4;
+
+    uint8_t code(char c) {
+        for (uint8_t i = 0; i < used_; ++i) {
+            if (palette_[i] == c) {
+                return i;
+            }
+        }
+        if (used_ == palette_size) {
+            return palette_size;
+        }
+        palette_[used_] = c;
+        return used_++;
+    }
+
+    uint8_t bits_[N][row_bytes]{};
+    char palette_[palette_size] = {'#', ' ', '.', '#'};
+    uint8_t used_ = 3;
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+};
+
+struct SimulationConfig {
+    size_t T = 2500;
+    size_t save_interval = 50;
+    std::string input_file = "../input.json";
+    std::string input_text;
+    std::string output_file = "../output.json";
+    unsigned seed = std::mt19937::default_seed;
+    bool verbose = true;
+    size_t workers = 1;
+    size_t pipeline_threads = 1;
+    size_t pipeline_band = 4;
+    bool incremental_flow = false;
+    size_t steady_window = 0;
+    double steady_eps = 1e-4;
+    size_t steady_moves = 0;
+    double time_limit = 0;
+    std::string frame_ring;
+    size_t frame_ring_slots = 8;
+    bool frame_ring_fields = false;
+    std::string snapshot_file;
+    size_t snapshot_interval = 0;
+    std::string resume_file;
+    bool history = false;
+    size_t history_limit = 0;
+    std::optional<size_t> rewind_to;
+    size_t replay_ticks = 0;
+    std::optional<double> replay_g;
+    std::vector<std::pair<char, double>> replay_rho;
+    std::optional<unsigned> replay_seed;
+};
+
+// Система считается установившейся, если window тактов подряд изменение
+// давления на клетку и относительное изменение суммы |v| не превышают eps,
+// а сдвинулось не больше max_moves клеток.
+class SteadyStateMonitor {
+public:
+    SteadyStateMonitor(size_t window = 0, double eps = 0, size_t max_moves = 0)
+        : window_(window), eps_(eps), max_moves_(max_moves) {}
+
+    bool enabled() const { return window_ > 0; }
+
+    bool update(double delta_p_per_cell, size_t moved, double velocity_norm) {
+        bool quiet = std::abs(delta_p_per_cell) <= eps_ && moved <= max_moves_
+            && std::abs(velocity_norm - last_norm_) <= eps_ * std::max(1.0, std::abs(last_norm_));
+        last_norm_ = velocity_norm;
+        quiet_ticks_ = quiet ? quiet_ticks_ + 1 : 0;
+        return enabled() && quiet_ticks_ >= window_;
+    }
+
+private:
+    size_t window_;
+    double eps_;
+    size_t max_moves_;
+    double last_norm_ = 0;
+    size_t quiet_ticks_ = 0;
+};
+
 template<typename Ptype, typename VType, typename VFlowType, size_t N = 36, size_t M = 84>
 class Simulator {
 public:
     Simulator() = default;
-    void run_simulation(size_t T, size_t save_count, const std::string& file_name);
+    size_t run_simulation(const SimulationConfig& config);
+    uint64_t state_hash() const;
+
+    // Пошаговый режим для встраивания: load, затем step или ticks. step
+    // возвращает false, когда сработало условие остановки из конфигурации.
+    bool load(const SimulationConfig& config);
+    bool step();
+    size_t step(size_t n);
+    Generator<size_t> ticks(size_t n);
+    size_t tick() const { return tick_; }
+
+    // Сжатый бинарный снимок полного состояния; продолжить с него можно через
+    // SimulationConfig::resume_file.
+    bool save_snapshot(const std::string& filename);
+    const SnapshotStats& snapshot_stats() const { return snapshot_stats_; }
+
+    // История тактов в памяти (SimulationConfig::history): rewind возвращает
+    // типы клеток, p, скорости и генератор к началу такта tick и отбрасывает
+    // более поздние такты. g и rho остаются текущими, их можно поменять перед
+    // повтором.
+    bool rewind(size_t tick);
+    void set_gravity(double g) { g_ = VType(g); }
+    void set_density(char type, double rho) { rho_[static_cast<unsigned char>(type)] = VType(rho); }
+    void reseed(unsigned seed);
+    HistoryStats history_stats() const { return history_ ? history_->stats() : HistoryStats{}; }
+
+    const CellGrid<N, M, compact_state>& cells() const { return field; }
+
+    GridView<const Ptype> pressure() const {
+        return {&p[0][0], field.size(), field[0].size(), M};
+    }
+
+    // Плоскость скоростей по направлению deltas[k].
+    GridView<const VType> velocity_plane(size_t k) const {
+        return {&velocity.v[0][0][k], field.size(), field[0].size(), M * deltas.size(), deltas.size()};
+    }
+
+    static constexpr double bytes_per_cell() {
+        return static_cast<double>(sizeof(Simulator)) / (N * M);
+    }
 
 private:
+    using DirCount = std::conditional_t<compact_state, uint8_t, int>;
+    using Epoch = std::conditional_t<compact_state, uint16_t, int>;
+
+    // В компактном режиме от снимка давления хранятся только строки x-1, x, x+1.
+    static constexpr size_t old_p_rows = compact_state ? 3 : N;
+    // Кэш весов перемещения в компактном режиме не держим.
+    static constexpr size_t weight_rows = compact_state ? 1 : N, weight_cols = compact_state ? 1 : M;
+
     VType rho_[256] {};
     VType g_;
-    int dirs[N][M]{};
-    Ptype p[N][M]{}, old_p[N][M]{};
+    DirCount dirs[N][M]{};
+    Ptype p[N][M]{}, old_p[old_p_rows][M]{};
 
-    std::vector<std::string> field;
+    CellGrid<N, M, compact_state> field;
+    size_t open_cells_ = 0;
 
     VectorField<VType, N, M> velocity;
     VectorField<VFlowType, N, M> velocity_flow;
-    int last_use[N][M] {};
+    Epoch last_use[N][M] {};
+
+    // Бит i — сосед по deltas[i] не стена; стены не меняются после prepare.
+    uint8_t open_dirs_[N][M]{};
+
+    // Веса перемещения: положительная часть скорости по каждому направлению,
+    // уже приведённая к типу суммы. Вес пересчитывается в move_prob, только
+    // если его скорость менялась (move_touched). Для p типа float и v типа
+    // double складываем в double, как и раньше, чтобы не менять округление.
+    using MoveWeight = std::conditional_t<std::is_same_v<Ptype, float> && std::is_same_v<VType, double>, VType, Ptype>;
+    std::array<MoveWeight, deltas.size()> move_weight_[weight_rows][weight_cols]{};
+    bool move_stale_ = true;
     int UT = 0;
+    bool flow_warm_ = false;
+    std::vector<std::pair<int, int>> flow_seeds_;
+
+    // Отметки изменений скоростей, по байту на запись velocity.v[x][y][k].
+    // Отметку ставит тот, кто меняет скорость, а в конвейере пару скоростей
+    // меняет только одна клетка, поэтому потоки не пишут в один байт.
+    // flow_touched: пропускная способность ребра изменилась после фазы
+    // потока, клетка уже в списке flow_changed_ (или в списке своей полосы).
+    // move_touched: вес перемещения в move_weight_ устарел.
+    static constexpr uint8_t flow_touched = 1, move_touched = 2;
+    std::array<uint8_t, deltas.size()> touched_[N][M]{};
+    std::vector<std::pair<int, int>> flow_changed_;
+    std::vector<std::vector<std::pair<int, int>>> band_changed_;
+    bool flow_rescan_ = true;
     std::mt19937 random_generator_;
 
+    SimulationConfig config_;
+    SteadyStateMonitor steady_;
+    std::chrono::steady_clock::time_point started_;
+    size_t tick_ = 0;
+    std::shared_ptr<FrameRingWriter> frames_;
+    std::shared_ptr<BandPipeline> pipeline_;
+    std::vector<Ptype> band_delta_p_;
+
+    // Положение генератора: копия состояния и число вызовов random01 после
+    // неё. Новая копия снимается, когда вызовов накопилось много. flow_warm
+    // говорит, годится ли сохранённый velocity_flow для --incremental-flow.
+    struct RngMark {
+        std::shared_ptr<const std::mt19937> base;
+        uint64_t draws;
+        bool flow_warm;
+    };
+    std::shared_ptr<TiledHistory<RngMark>> history_;
+    std::shared_ptr<const std::mt19937> rng_base_;
+    uint64_t rng_draws_ = 0;
+    SnapshotStats snapshot_stats_;
+
     struct ParticleParams {
         char type;
         Ptype cur_p;
         std::array<VType, deltas.size()> v;
 
         void swap_with(Simulator& fs, int x, int y) {
-            std::swap(fs.field[x][y], type);
+            char cell = fs.field[x][y];
+            fs.field[x][y] = type;
+            type = cell;
             std::swap(fs.p[x][y], cur_p);
             std::swap(fs.velocity.v[x][y], v);
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                fs.touch(x, y, k, fs.flow_changed_);
+            }
         }
     };
 
-    void readInputFile(const std::string& filename);
+    bool readInputFile(const std::string& filename);
+    bool readInput(std::istream& file);
 
     std::tuple<VType, bool, std::pair<int, int>> propagate_flow(int x, int y, VType lim);
+    VFlowType cancel_flow(int x, int y, int tx, int ty, VFlowType lim);
+    void warm_start_flow();
     double random01();
+    void next_epoch();
+    Ptype* old_row(size_t x);
     void propagate_stop(int x, int y, bool force = false);
-    Ptype move_prob(int x, int y); 
+    Ptype move_prob(int x, int y, std::array<Ptype, deltas.size()>* tres = nullptr);
     bool propagate_move(int x, int y, bool is_first);
     void saveToJson(const std::string& filename) const;
+    bool readSnapshot(const std::string& filename);
+
+    void touch(int x, int y, size_t k, std::vector<std::pair<int, int>>& changed);
+    void touch_all();
+    void clear_touched();
+
+    void configure(const SimulationConfig& config);
+    void reset();
+    bool prepare();
+    void apply_gravity(size_t x_begin, size_t x_end, std::vector<std::pair<int, int>>& changed);
+    void apply_pressure(size_t x_begin, size_t x_end, Ptype& total_delta_p, std::vector<std::pair<int, int>>& changed, bool snapshot = true);
+    void apply_forces_pipelined(Ptype& total_delta_p);
+    void apply_flow(Ptype& total_delta_p);
+    bool apply_move(size_t& moved);
+    double velocity_norm() const;
+    void publish_frame(size_t i);
+    bool finish_tick(size_t i, bool prop, size_t moved, Ptype total_delta_p);
+    void record_history();
+    size_t replay();
+    size_t run_decomposed();
 
 };
 
@@ -82,15 +446,43 @@ std::string trim(const std::string& str) {
 }
 
 template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
-void Simulator<Ptype, VType, VFlowType, N, M>::readInputFile(const std::string& filename)
+bool Simulator<Ptype, VType, VFlowType, N, M>::readInputFile(const std::string& filename)
 {
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Ошибка: Не удалось открыть файл " << filename << std::endl;
-        return;
+        return false;
+    }
+    return readInput(file);
+}
+
+// Число после двоеточия в input.json, запятая в конце допускается.
+template<typename T>
+bool parse_number(const std::string& text, T& out) {
+    std::string value = trim(text);
+    if (!value.empty() && value.back() == ',') {
+        value.pop_back();
     }
+    size_t used = 0;
+    try {
+        double number = std::stod(value, &used);
+        if (used == value.size()) {
+            out = T(number);
+            return true;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Ошибка: не удалось разобрать число: " << text << std::endl;
+    return false;
+}
 
+// false, если число не разобралось, строка поля не поместилась в N x M или
+// поле пустое.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::readInput(std::istream& file)
+{
     std::string line;
+    bool ok = true;
 
     while (std::getline(file, line)) {
         line = trim(line);
@@ -98,7 +490,9 @@ void Simulator<Ptype, VType, VFlowType, N, M>::readInputFile(const std::string&
         if (line.find("\"g\"") != std::string::npos) {
             size_t pos = line.find(":");
             if (pos != std::string::npos) {
-                g_ = std::stod(trim(line.substr(pos + 1)));
+                if (!parse_number(line.substr(pos + 1), g_)) {
+                    return false;
+                }
             }
         }
         else if (line.find("\"rho\"") != std::string::npos) {
@@ -111,12 +505,14 @@ void Simulator<Ptype, VType, VFlowType, N, M>::readInputFile(const std::string&
                     std::string key = trim(line.substr(0, colonPos));
                     std::string value = trim(line.substr(colonPos + 1));
 
-                    if (key.front() == '"' && key.back() == '"') {
+                    if (key.size() >= 2 && key.front() == '"' && key.back() == '"') {
                         key = key.substr(1, key.size() - 2);
                     }
 
                     char keyChar = key.empty() ? ' ' : key[0];
-                    rho_[keyChar] = std::stod(value);
+                    if (!parse_number(value, rho_[static_cast<unsigned char>(keyChar)])) {
+                        return false;
+                    }
                 }
             }
         }
@@ -134,15 +530,23 @@ void Simulator<Ptype, VType, VFlowType, N, M>::readInputFile(const std::string&
                         line = line.substr(1, line.size() - 2);
                     }
 
-                    field.push_back(line);
+                    if (!field.push_back(line)) {
+                        std::cerr << "Ошибка: строка поля не помещается в " << N << "x" << M << ": " << line << std::endl;
+                        ok = false;
+                    }
                 }
             }
         }
     }
 
-    file.close();
-    
-    std::cout << "Поле загружено. Размер: " << field.size() << " строк." << std::endl;
+    if (field.size() == 0) {
+        std::cerr << "Ошибка: поле пустое" << std::endl;
+        return false;
+    }
+    if (config_.verbose && ok) {
+        std::cout << "Поле загружено. Размер: " << field.size() << " строк." << std::endl;
+    }
+    return ok;
 }
 
 
@@ -180,10 +584,123 @@ Simulator<Ptype, VType, VFlowType, N, M>::propagate_flow(int x, int y, VType lim
     return {ret, 0, {0, 0}};
 };
 
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+VFlowType Simulator<Ptype, VType, VFlowType, N, M>::cancel_flow(int x, int y, int tx, int ty, VFlowType lim)
+{
+    if (x == tx && y == ty) {
+        return lim;
+    }
+    last_use[x][y] = UT;
+    for (auto [dx, dy] : deltas) {
+        int nx = x + dx, ny = y + dy;
+        if (field[nx][ny] == '#' || last_use[nx][ny] == UT) {
+            continue;
+        }
+        auto &flow = velocity_flow.get(x, y, dx, dy);
+        if (!(flow > 0)) {
+            continue;
+        }
+        auto t = cancel_flow(nx, ny, tx, ty, std::min(lim, flow));
+        if (t > 0) {
+            flow -= t;
+            flow_seeds_.emplace_back(x, y);
+            return t;
+        }
+    }
+    return 0;
+}
+
+// Поток прошлого такта обрезается по новым скоростям. Поток состоит из
+// циклов, поэтому снятый с ребра a->b излишек снимается и с пути потока
+// от b обратно к a. Поиск дополняющих циклов затем запускается только из
+// клеток, у которых осталась неиспользованная пропускная способность.
+// Смотрятся только клетки, чьи скорости менялись с прошлой фазы потока
+// (flow_changed_), и клетки, с которых cancel_flow снял поток; у остальных
+// поток не превышает пропускную способность и свободного остатка не
+// прибавилось: после записи потока в скорости поток каждого ребра равен
+// его пропускной способности. Клетки обходятся по порядку строк, как при
+// полном просмотре, поэтому результат не зависит от того, откуда взялись
+// отметки. После rewind, загрузки и шага с полосами в других процессах
+// отметок нет, тогда просматривается всё поле.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::warm_start_flow()
+{
+    flow_seeds_.clear();
+    auto trim = [&](int x, int y) {
+        bool seed = false;
+        for (auto [dx, dy] : deltas) {
+            int nx = x + dx, ny = y + dy;
+            auto cap = static_cast<VFlowType>(velocity.get(x, y, dx, dy));
+            auto &flow = velocity_flow.get(x, y, dx, dy);
+            if (cap < 0) {
+                cap = 0;
+            }
+            if (flow > cap) {
+                auto excess = flow - cap;
+                flow = cap;
+                while (excess > 0) {
+                    next_epoch();
+                    auto t = cancel_flow(nx, ny, x, y, excess);
+                    if (!(t > 0)) {
+                        break;
+                    }
+                    excess -= t;
+                }
+            }
+            seed = seed || (field[nx][ny] != '#' && flow < cap);
+        }
+        if (seed) {
+            flow_seeds_.emplace_back(x, y);
+        }
+    };
+
+    if (flow_rescan_) {
+        for (size_t x = 0; x < field.size(); ++x) {
+            for (size_t y = 0; y < field[0].size(); ++y) {
+                if (field[x][y] != '#') {
+                    trim(x, y);
+                }
+            }
+        }
+    } else {
+        std::sort(flow_changed_.begin(), flow_changed_.end());
+        flow_changed_.erase(std::unique(flow_changed_.begin(), flow_changed_.end()), flow_changed_.end());
+        for (auto [x, y] : flow_changed_) {
+            if (field[x][y] != '#') {
+                trim(x, y);
+            }
+        }
+    }
+    clear_touched();
+}
+
+// Эпохи last_use сравниваются только с текущим UT, поэтому при переполнении
+// узкого счётчика достаточно обнулить массив и начать отсчёт заново.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::next_epoch()
+{
+    if (UT > std::numeric_limits<Epoch>::max() - 2) {
+        std::fill(&last_use[0][0], &last_use[0][0] + N * M, 0);
+        UT = 0;
+    }
+    UT += 2;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+Ptype* Simulator<Ptype, VType, VFlowType, N, M>::old_row(size_t x)
+{
+    if constexpr (compact_state) {
+        return old_p[x % old_p_rows];
+    } else {
+        return old_p[x];
+    }
+}
+
 template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
 double Simulator<Ptype, VType, VFlowType, N, M>::random01()
 {       
     std::uniform_real_distribution<double> dist(0.0, 1.0);
+    ++rng_draws_;
     return dist(random_generator_);
 }
 
@@ -192,9 +709,9 @@ void Simulator<Ptype, VType, VFlowType, N, M>::propagate_stop(int x, int y, bool
 {
     if (!force) {
         bool stop = true;
-        for (auto [dx, dy] : deltas) {
-            int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.get(x, y, dx, dy) > 0) {
+        for (size_t i = 0; i < deltas.size(); ++i) {
+            int nx = x + deltas[i].first, ny = y + deltas[i].second;
+            if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.v[x][y][i] > 0) {
                 stop = false;
                 break;
             }
@@ -204,30 +721,52 @@ void Simulator<Ptype, VType, VFlowType, N, M>::propagate_stop(int x, int y, bool
         }
     }
     last_use[x][y] = UT;
-    for (auto [dx, dy] : deltas) {
-        int nx = x + dx, ny = y + dy;
-        if (field[nx][ny] == '#' || last_use[nx][ny] == UT || velocity.get(x, y, dx, dy) > 0) {
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        int nx = x + deltas[i].first, ny = y + deltas[i].second;
+        if (field[nx][ny] == '#' || last_use[nx][ny] == UT || velocity.v[x][y][i] > 0) {
             continue;
         }
         propagate_stop(nx, ny);
     }
 }
 
+// Сумма положительных скоростей в открытые и ещё не занятые на этом такте
+// соседние клетки; tres получает накопленные суммы для выбора направления.
+// Вне компактного режима суммируются кэшированные веса, устаревшие
+// пересчитываются здесь же.
 template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
-Ptype Simulator<Ptype, VType, VFlowType, N, M>::move_prob(int x, int y)
+Ptype Simulator<Ptype, VType, VFlowType, N, M>::move_prob(int x, int y, std::array<Ptype, deltas.size()>* tres)
 {
+    fixed_telemetry::site("сумма скоростей");
     Ptype sum = 0;
+    if constexpr (compact_state) {
+        const auto& v = velocity.v[x][y];
+        for (size_t i = 0; i < deltas.size(); ++i) {
+            if (((open_dirs_[x][y] >> i) & 1) && last_use[x + deltas[i].first][y + deltas[i].second] != UT && v[i] > 0) {
+                sum += v[i];
+            }
+            if (tres) {
+                (*tres)[i] = sum;
+            }
+        }
+        return sum;
+    }
+
+    auto& w = move_weight_[x][y];
+    auto& marks = touched_[x][y];
     for (size_t i = 0; i < deltas.size(); ++i) {
-        auto [dx, dy] = deltas[i];
-        int nx = x + dx, ny = y + dy;
-        if (field[nx][ny] == '#' || last_use[nx][ny] == UT) {
-            continue;
+        if (marks[i] & move_touched) {
+            const VType& v = velocity.v[x][y][i];
+            w[i] = v > 0 ? static_cast<MoveWeight>(v) : MoveWeight{};
+            marks[i] &= ~move_touched;
         }
-        auto v = velocity.get(x, y, dx, dy);
-        if (v < 0) {
-            continue;
+    }
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        bool open = ((open_dirs_[x][y] >> i) & 1) & (last_use[x + deltas[i].first][y + deltas[i].second] != UT);
+        sum += open ? w[i] : MoveWeight{};
+        if (tres) {
+            (*tres)[i] = sum;
         }
-        sum += v;
     }
     return sum;
 }
@@ -240,29 +779,18 @@ bool Simulator<Ptype, VType, VFlowType, N, M>::propagate_move(int x, int y, bool
     int nx = -1, ny = -1;
     do {
         std::array<Ptype, deltas.size()> tres;
-        Ptype sum = 0;
-        for (size_t i = 0; i < deltas.size(); ++i) {
-            auto [dx, dy] = deltas[i];
-            int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] == '#' || last_use[nx][ny] == UT) {
-                tres[i] = sum;
-                continue;
-            }
-            auto v = velocity.get(x, y, dx, dy);
-            if (v < 0) {
-                tres[i] = sum;
-                continue;
-            }
-            sum += v;
-            tres[i] = sum;
-        }
+        Ptype sum = move_prob(x, y, &tres);
 
         if (sum == 0) {
             break;
         }
 
+        fixed_telemetry::site("sum * random01");
         Ptype p = sum * random01();
-        size_t d = std::ranges::upper_bound(tres, p) - tres.begin();
+        size_t d = 0;
+        for (const Ptype& t : tres) {
+            d += !(p < t);
+        }
 
         auto [dx, dy] = deltas[d];
         nx = x + dx;
@@ -273,9 +801,8 @@ bool Simulator<Ptype, VType, VFlowType, N, M>::propagate_move(int x, int y, bool
     } while (!ret);
     last_use[x][y] = UT;
     for (size_t i = 0; i < deltas.size(); ++i) {
-        auto [dx, dy] = deltas[i];
-        int nx = x + dx, ny = y + dy;
-        if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.get(x, y, dx, dy) < 0) {
+        int nx = x + deltas[i].first, ny = y + deltas[i].second;
+        if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.v[x][y][i] < 0) {
             propagate_stop(nx, ny);
         }
     }
@@ -323,75 +850,418 @@ void Simulator<Ptype, VType, VFlowType, N, M>::saveToJson(const std::string& fil
 }
 
 
+namespace snapshot_format {
+constexpr uint32_t magic = 0x504e5346;
+constexpr uint8_t version = 2;
+}
+
+// Формат: заголовок с типами и размером, g и rho, состояние генератора, затем
+// типы клеток сериями и плоскости p и скоростей через put_plane. При
+// --incremental-flow после прогрева в конце идут ещё плоскости velocity_flow,
+// чтобы продолжение совпало с непрерывным расчётом. dirs и счётчики эпох не
+// сохраняются: они восстанавливаются при загрузке.
 template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
-void Simulator<Ptype, VType, VFlowType, N, M>::run_simulation(size_t T, size_t save_interval, const std::string& file_name)
+bool Simulator<Ptype, VType, VFlowType, N, M>::save_snapshot(const std::string& filename)
 {
-    if (file_name.size() == 0) {
-        readInputFile("../input.json");
-    } else {
-        readInputFile(file_name);
+    using PTraits = PlaneTraits<Ptype>;
+    using VTraits = PlaneTraits<VType>;
+    using FTraits = PlaneTraits<VFlowType>;
+    auto start = std::chrono::steady_clock::now();
+    const size_t rows = field.size(), cols = field[0].size(), cells = rows * cols;
+    const bool with_flow = config_.incremental_flow && flow_warm_;
+
+    SnapshotWriter out;
+    out.put(snapshot_format::magic);
+    out.put(snapshot_format::version);
+    out.put(PTraits::kind);
+    out.put(static_cast<uint8_t>(sizeof(Ptype)));
+    out.put(PTraits::frac_bits);
+    out.put(VTraits::kind);
+    out.put(static_cast<uint8_t>(sizeof(VType)));
+    out.put(VTraits::frac_bits);
+    out.put(static_cast<uint32_t>(rows));
+    out.put(static_cast<uint32_t>(cols));
+    out.put(static_cast<uint64_t>(tick_));
+    out.put(static_cast<uint8_t>(with_flow));
+    if (with_flow) {
+        out.put(FTraits::kind);
+        out.put(static_cast<uint8_t>(sizeof(VFlowType)));
+        out.put(FTraits::frac_bits);
+    }
+
+    out.put(VTraits::to_raw(g_));
+    for (int c = 0; c < 256; ++c) {
+        if (rho_[c] != VType{}) {
+            out.put(static_cast<uint8_t>(c));
+            out.put(VTraits::to_raw(rho_[c]));
+        }
+    }
+    out.put(static_cast<uint8_t>(0));
+
+    std::ostringstream rng;
+    rng << random_generator_;
+    out.put_varint(rng.str().size());
+    out.put_bytes(rng.str().data(), rng.str().size());
+
+    std::vector<char> types(cells);
+    for (size_t x = 0; x < rows; ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            types[x * cols + y] = field[x][y];
+        }
+    }
+    out.put_runs(types.data(), cells);
+
+    std::vector<typename PTraits::Raw> p_plane(cells);
+    for (size_t x = 0; x < rows; ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            p_plane[x * cols + y] = PTraits::to_raw(p[x][y]);
+        }
+    }
+    out.put_plane(p_plane.data(), cells);
+
+    std::vector<typename VTraits::Raw> v_plane(cells);
+    for (size_t k = 0; k < deltas.size(); ++k) {
+        for (size_t x = 0; x < rows; ++x) {
+            for (size_t y = 0; y < cols; ++y) {
+                v_plane[x * cols + y] = VTraits::to_raw(velocity.v[x][y][k]);
+            }
+        }
+        out.put_plane(v_plane.data(), cells);
+    }
+
+    if (with_flow) {
+        std::vector<typename FTraits::Raw> f_plane(cells);
+        for (size_t k = 0; k < deltas.size(); ++k) {
+            for (size_t x = 0; x < rows; ++x) {
+                for (size_t y = 0; y < cols; ++y) {
+                    f_plane[x * cols + y] = FTraits::to_raw(velocity_flow.v[x][y][k]);
+                }
+            }
+            out.put_plane(f_plane.data(), cells);
+        }
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Не удалось открыть файл для записи: " << filename << std::endl;
+        return false;
+    }
+    file.write(out.data().data(), static_cast<std::streamsize>(out.size()));
+    file.close();
+
+    snapshot_stats_.count++;
+    snapshot_stats_.raw_bytes += cells * (1 + sizeof(Ptype) + deltas.size() * sizeof(VType)
+                                          + (with_flow ? deltas.size() * sizeof(VFlowType) : 0));
+    snapshot_stats_.compressed_bytes += out.size();
+    snapshot_stats_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::readSnapshot(const std::string& filename)
+{
+    using PTraits = PlaneTraits<Ptype>;
+    using VTraits = PlaneTraits<VType>;
+    using FTraits = PlaneTraits<VFlowType>;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Ошибка: Не удалось открыть файл " << filename << std::endl;
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    SnapshotReader in(data.data(), data.size());
+
+    if (in.get<uint32_t>() != snapshot_format::magic || in.get<uint8_t>() != snapshot_format::version) {
+        std::cerr << "Ошибка: " << filename << " не является снимком симулятора" << std::endl;
+        return false;
+    }
+    const uint8_t expected[] = {PTraits::kind, sizeof(Ptype), PTraits::frac_bits, VTraits::kind, sizeof(VType), VTraits::frac_bits};
+    for (uint8_t byte : expected) {
+        if (in.get<uint8_t>() != byte) {
+            std::cerr << "Ошибка: снимок " << filename << " записан для других типов p или v" << std::endl;
+            return false;
+        }
+    }
+    size_t rows = in.get<uint32_t>(), cols = in.get<uint32_t>();
+    if (rows > N || cols > M) {
+        std::cerr << "Ошибка: снимок " << rows << "x" << cols << " не помещается в " << N << "x" << M << std::endl;
+        return false;
+    }
+    tick_ = in.get<uint64_t>();
+    const bool with_flow = in.get<uint8_t>() != 0;
+    if (with_flow) {
+        const uint8_t flow_expected[] = {FTraits::kind, sizeof(VFlowType), FTraits::frac_bits};
+        for (uint8_t byte : flow_expected) {
+            if (in.get<uint8_t>() != byte) {
+                std::cerr << "Ошибка: снимок " << filename << " записан для другого типа v_flow" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    g_ = VTraits::from_raw(in.get<typename VTraits::Raw>());
+    while (uint8_t c = in.get<uint8_t>()) {
+        rho_[c] = VTraits::from_raw(in.get<typename VTraits::Raw>());
+    }
+
+    std::string rng(in.get_varint(), '\0');
+    in.get_bytes(rng.data(), rng.size());
+    std::istringstream(rng) >> random_generator_;
+
+    const size_t cells = rows * cols;
+    std::vector<char> types(cells);
+    in.get_runs(types.data(), cells);
+    for (size_t x = 0; x < rows && in.ok(); ++x) {
+        if (!field.push_back(std::string(types.data() + x * cols, cols))) {
+            std::cerr << "Ошибка: строка поля не помещается в " << N << "x" << M << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<typename PTraits::Raw> p_plane(cells);
+    in.get_plane(p_plane.data(), cells);
+    for (size_t x = 0; x < rows; ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            p[x][y] = PTraits::from_raw(p_plane[x * cols + y]);
+        }
+    }
+
+    std::vector<typename VTraits::Raw> v_plane(cells);
+    for (size_t k = 0; k < deltas.size(); ++k) {
+        in.get_plane(v_plane.data(), cells);
+        for (size_t x = 0; x < rows; ++x) {
+            for (size_t y = 0; y < cols; ++y) {
+                velocity.v[x][y][k] = VTraits::from_raw(v_plane[x * cols + y]);
+            }
+        }
+    }
+
+    if (with_flow) {
+        std::vector<typename FTraits::Raw> f_plane(cells);
+        for (size_t k = 0; k < deltas.size(); ++k) {
+            in.get_plane(f_plane.data(), cells);
+            for (size_t x = 0; x < rows; ++x) {
+                for (size_t y = 0; y < cols; ++y) {
+                    velocity_flow.v[x][y][k] = FTraits::from_raw(f_plane[x * cols + y]);
+                }
+            }
+        }
+        flow_warm_ = config_.incremental_flow;
+    }
+
+    if (!in.ok()) {
+        std::cerr << "Ошибка: снимок " << filename << " повреждён" << std::endl;
+        return false;
+    }
+    if (config_.verbose) {
+        std::cout << "Снимок загружен: такт " << tick_ << ", " << rows << " строк." << std::endl;
+    }
+    return true;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::prepare()
+{
+    random_generator_.seed(config_.seed);
+    touch_all();
+    if (!config_.resume_file.empty()) {
+        if (!readSnapshot(config_.resume_file)) {
+            return false;
+        }
+    } else if (!config_.input_text.empty()) {
+        std::istringstream input(config_.input_text);
+        if (!readInput(input)) {
+            return false;
+        }
+    } else if (!readInputFile(config_.input_file.empty() ? "../input.json" : config_.input_file)) {
+        return false;
     }
 
     if (rho_[' '] == 0 || g_ == 0) {
         std::cout << "Слишком маленькая точность, переменные равны 0\n";
-        return;
+        return false;
     } else if (rho_['.'] <= 0) {
         std::cout << "Слишком маленькая точность, переменные переполнились\n";
-        return;
+        return false;
     }
-    
 
     for (size_t x = 0; x < field.size(); ++x) {
-            for (size_t y = 0; y < field[0].size(); ++y) {
-                if (field[x][y] == '#')
-                    continue;
-                for (auto [dx, dy] : deltas) {
-                    dirs[x][y] += (field[x + dx][y + dy] != '#');
-                }
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            if (field[x][y] == '#')
+                continue;
+            ++open_cells_;
+            for (size_t i = 0; i < deltas.size(); ++i) {
+                bool open = field[x + deltas[i].first][y + deltas[i].second] != '#';
+                dirs[x][y] += open;
+                open_dirs_[x][y] |= open << i;
             }
         }
+    }
+
+    frames_.reset();
+    if (!config_.frame_ring.empty()) {
+        uint32_t flags = config_.frame_ring_fields ? FrameRingHeader::has_pressure | FrameRingHeader::has_speed : 0;
+        frames_ = std::make_shared<FrameRingWriter>();
+        if (!frames_->create(config_.frame_ring, field.size(), field[0].size(), std::max<size_t>(config_.frame_ring_slots, 2), flags)) {
+            frames_.reset();
+            return false;
+        }
+    }
 
-    for (size_t i = 0; i < T; ++i) {
+    // В компактном режиме снимок давления хранит только три строки, а при
+    // --workers полосы уже считают отдельные процессы.
+    if (compact_state || config_.workers > 1 || config_.pipeline_threads <= 1) {
+        pipeline_.reset();
+    } else if (!pipeline_ || pipeline_->threads() != config_.pipeline_threads) {
+        pipeline_ = std::make_shared<BandPipeline>(config_.pipeline_threads);
+    }
 
-        Ptype total_delta_p = 0;    
-        for (size_t x = 0; x < field.size(); ++x) {
-            for (size_t y = 0; y < field[0].size(); ++y) {
-                if (field[x][y] == '#')
-                    continue;
-                if (field[x + 1][y] != '#')
-                    velocity.add(x, y, 1, 0, g_);
+    history_.reset();
+    if ((config_.history || config_.rewind_to) && config_.workers > 1) {
+        std::cerr << "Ошибка: история тактов не работает с разбиением на полосы (workers > 1)" << std::endl;
+        return false;
+    }
+    if (config_.history || config_.rewind_to) {
+        const size_t rows = field.size(), cols = field[0].size();
+        std::vector<HistoryPlane> planes = {
+            {reinterpret_cast<unsigned char*>(field.row_data(0)), rows, field.row_bytes, field.row_bytes},
+            {reinterpret_cast<unsigned char*>(&p[0][0]), rows, cols * sizeof(Ptype), sizeof(p[0])},
+            {reinterpret_cast<unsigned char*>(&velocity.v[0][0]), rows, cols * sizeof(velocity.v[0][0]), sizeof(velocity.v[0])},
+        };
+        // Тёплый старт потока читает поток прошлого такта, без него повтор
+        // разойдётся с исходным расчётом.
+        if (config_.incremental_flow) {
+            planes.push_back({reinterpret_cast<unsigned char*>(&velocity_flow.v[0][0]), rows,
+                              cols * sizeof(velocity_flow.v[0][0]), sizeof(velocity_flow.v[0])});
+        }
+        history_ = std::make_shared<TiledHistory<RngMark>>();
+        history_->start(std::move(planes), config_.history_limit);
+        rng_base_.reset();
+        record_history();
+    }
+    return true;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::apply_gravity(size_t x_begin, size_t x_end, std::vector<std::pair<int, int>>& changed)
+{
+    fixed_telemetry::PhaseScope phase(fixed_telemetry::Gravity);
+    for (size_t x = x_begin; x < x_end; ++x) {
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            if (field[x][y] == '#')
+                continue;
+            if (field[x + 1][y] != '#') {
+                fixed_telemetry::site("v += g");
+                velocity.add(x, y, 1, 0, g_);
+                touch(x, y, 1, changed);
             }
         }
+    }
+}
 
-        memcpy(this->old_p, this->p, sizeof(this->p));
-        for (size_t x = 0; x < field.size(); ++x) {
-            for (size_t y = 0; y < field[0].size(); ++y) {
-                if (field[x][y] == '#')
-                    continue;
-                for (auto [dx, dy] : deltas) {
-                    int nx = x + dx, ny = y + dy;
-                    if (field[nx][ny] != '#' && old_p[nx][ny] < old_p[x][y]) {
-                        auto delta_p = old_p[x][y] - old_p[nx][ny];
-                        auto force = delta_p;
-                        auto &contr = velocity.get(nx, ny, -dx, -dy);
-                        if (force <= contr * rho_[(int) field[nx][ny]]) {
-                            contr -= static_cast<VType>(static_cast<VType>(force) / rho_[(int) field[nx][ny]]);
-                            continue;
-                        }
-                        force -= contr * rho_[(int) field[nx][ny]];
-                        contr = 0;
-                        velocity.add(x, y, dx, dy, static_cast<VType>(force) / rho_[(int) field[x][y]]);
-                        p[x][y] -= force / dirs[x][y];
-                        total_delta_p -= force / dirs[x][y];
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::apply_pressure(size_t x_begin, size_t x_end, Ptype& total_delta_p, std::vector<std::pair<int, int>>& changed, bool snapshot)
+{
+    fixed_telemetry::PhaseScope phase(fixed_telemetry::Pressure);
+    const size_t lo = x_begin > 0 ? x_begin - 1 : 0;
+    const size_t hi = std::min(compact_state ? x_begin + 1 : x_end + 1, field.size());
+    for (size_t x = lo; snapshot && x < hi; ++x) {
+        memcpy(old_row(x), p[x], sizeof(p[0]));
+    }
+
+    for (size_t x = x_begin; x < x_end; ++x) {
+        if (compact_state && snapshot && x + 1 < field.size()) {
+            memcpy(old_row(x + 1), p[x + 1], sizeof(p[0]));
+        }
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            if (field[x][y] == '#')
+                continue;
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                auto [dx, dy] = deltas[k];
+                int nx = x + dx, ny = y + dy;
+                if (field[nx][ny] != '#' && old_row(nx)[ny] < old_row(x)[y]) {
+                    fixed_telemetry::site("delta_p = p - p_соседа");
+                    auto delta_p = old_row(x)[y] - old_row(nx)[ny];
+                    auto force = delta_p;
+                    auto &contr = velocity.get(nx, ny, -dx, -dy);
+                    touch(nx, ny, k ^ 1, changed);
+                    fixed_telemetry::site("contr * rho");
+                    if (force <= contr * rho_[(int) field[nx][ny]]) {
+                        fixed_telemetry::site("contr -= force / rho");
+                        contr -= static_cast<VType>(static_cast<VType>(force) / rho_[(int) field[nx][ny]]);
+                        continue;
                     }
+                    fixed_telemetry::site("force -= contr * rho");
+                    force -= contr * rho_[(int) field[nx][ny]];
+                    contr = 0;
+                    fixed_telemetry::site("v += force / rho");
+                    velocity.add(x, y, dx, dy, static_cast<VType>(force) / rho_[(int) field[x][y]]);
+                    touch(x, y, k, changed);
+                    fixed_telemetry::site("p -= force / dirs");
+                    p[x][y] -= force / dirs[x][y];
+                    total_delta_p -= force / dirs[x][y];
                 }
             }
         }
+    }
+}
+
+// Гравитация и давление по полосам строк на нескольких потоках. Снимок
+// давления полосы снимается вместе с гравитацией, а давление полосы
+// считается, когда соседние полосы уже прошли гравитацию. Пару скоростей
+// на границе полос меняет только клетка с большим давлением, поэтому
+// результат совпадает с последовательным. Частичные суммы изменения
+// давления и списки изменённых клеток собираются по порядку полос.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::apply_forces_pipelined(Ptype& total_delta_p)
+{
+    const size_t rows = field.size();
+    const size_t band = std::max<size_t>(config_.pipeline_band, 1);
+    const size_t bands = (rows + band - 1) / band;
+    band_delta_p_.assign(bands, Ptype{});
+    band_changed_.resize(bands);
+    pipeline_->run(bands, [&](size_t b) {
+        const size_t x0 = b * band, x1 = std::min(x0 + band, rows);
+        apply_gravity(x0, x1, band_changed_[b]);
+        memcpy(old_p[x0], p[x0], (x1 - x0) * sizeof(p[0]));
+    }, [&](size_t b) {
+        const size_t x0 = b * band, x1 = std::min(x0 + band, rows);
+        apply_pressure(x0, x1, band_delta_p_[b], band_changed_[b], false);
+    });
+    for (const Ptype& delta : band_delta_p_) {
+        total_delta_p += delta;
+    }
+    for (auto& changed : band_changed_) {
+        flow_changed_.insert(flow_changed_.end(), changed.begin(), changed.end());
+        changed.clear();
+    }
+}
 
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::apply_flow(Ptype& total_delta_p)
+{
+    fixed_telemetry::PhaseScope phase(fixed_telemetry::Flow);
+    fixed_telemetry::site("поиск циклов");
+    bool prop = false;
+    if (config_.incremental_flow && flow_warm_) {
+        warm_start_flow();
+        do {
+            next_epoch();
+            prop = 0;
+            for (auto [x, y] : flow_seeds_) {
+                if (last_use[x][y] != UT) {
+                    auto [t, local_prop, _] = propagate_flow(x, y, 1);
+                    if (t > 0) {
+                        prop = 1;
+                    }
+                }
+            }
+        } while (prop);
+    } else {
         velocity_flow = {};
-        bool prop = false;
         do {
-            UT += 2;
+            next_epoch();
             prop = 0;
             for (size_t x = 0; x < field.size(); ++x) {
                 for (size_t y = 0; y < field[0].size(); ++y) {
@@ -404,57 +1274,572 @@ void Simulator<Ptype, VType, VFlowType, N, M>::run_simulation(size_t T, size_t s
                 }
             }
         } while (prop);
+        flow_warm_ = true;
+        clear_touched();
+    }
 
-        for (size_t x = 0; x < field.size(); ++x) {
-            for (size_t y = 0; y < field[0].size(); ++y) {
-                if (field[x][y] == '#')
-                    continue;
-                for (auto [dx, dy] : deltas) {
-                    auto old_v = velocity.get(x, y, dx, dy);
-                    auto new_v = velocity_flow.get(x, y, dx, dy);
-                    if (old_v > 0) {
-                        assert(static_cast<float>(new_v) <= static_cast<float>(old_v));
-                        velocity.get(x, y, dx, dy) = static_cast<VType>(new_v);
-                        auto force = (static_cast<VFlowType>(old_v) - new_v) * rho_[(int) field[x][y]];
-                        if (field[x][y] == '.')
-                            force *= 0.8;
-                        if (field[x + dx][y + dy] == '#') {
-                            p[x][y] += force / dirs[x][y];
-                            total_delta_p += force / dirs[x][y];
-                        } else {
-                            p[x + dx][y + dy] += force / dirs[x + dx][y + dy];
-                            total_delta_p += force / dirs[x + dx][y + dy];
-                        }
+    for (size_t x = 0; x < field.size(); ++x) {
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            if (field[x][y] == '#')
+                continue;
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                auto [dx, dy] = deltas[k];
+                auto old_v = velocity.get(x, y, dx, dy);
+                auto new_v = velocity_flow.get(x, y, dx, dy);
+                if (old_v > 0) {
+                    assert(static_cast<float>(new_v) <= static_cast<float>(old_v));
+                    fixed_telemetry::site("v = v_flow");
+                    velocity.get(x, y, dx, dy) = static_cast<VType>(new_v);
+                    if (static_cast<VFlowType>(velocity.get(x, y, dx, dy)) != new_v) {
+                        touch_all();
+                    }
+                    if (!compact_state && velocity.get(x, y, dx, dy) != old_v) {
+                        touched_[x][y][k] |= move_touched;
+                    }
+                    fixed_telemetry::site("force = (v - v_flow) * rho");
+                    auto force = (static_cast<VFlowType>(old_v) - new_v) * rho_[(int) field[x][y]];
+                    if (field[x][y] == '.')
+                        force *= 0.8;
+                    fixed_telemetry::site("p += force / dirs");
+                    if (field[x + dx][y + dy] == '#') {
+                        p[x][y] += force / dirs[x][y];
+                        total_delta_p += force / dirs[x][y];
+                    } else {
+                        p[x + dx][y + dy] += force / dirs[x + dx][y + dy];
+                        total_delta_p += force / dirs[x + dx][y + dy];
                     }
                 }
             }
         }
+    }
+}
 
-        UT += 2;
-        prop = false;
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::apply_move(size_t& moved)
+{
+    fixed_telemetry::PhaseScope phase(fixed_telemetry::Move);
+    next_epoch();
+    if (!compact_state && move_stale_) {
         for (size_t x = 0; x < field.size(); ++x) {
-            for (size_t y = 0; y < field[0].size(); ++y) {
-                if (field[x][y] != '#' && last_use[x][y] != UT) {
-                    if (move_prob(x, y) > random01()) {
-                        prop = true;
-                        propagate_move(x, y, true);
-                    } else {
-                        propagate_stop(x, y, true);
-                    }
+            for (auto& marks : touched_[x]) {
+                for (uint8_t& mark : marks) {
+                    mark |= move_touched;
                 }
             }
         }
-        if ((i + 1) % save_interval == 0) {
-            std::string filename = "../output.json";
-            saveToJson(filename);
+        move_stale_ = false;
+    }
+    bool prop = false;
+    for (size_t x = 0; x < field.size(); ++x) {
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            if (field[x][y] != '#' && last_use[x][y] != UT) {
+                if (move_prob(x, y) > random01()) {
+                    prop = true;
+                    moved += propagate_move(x, y, true);
+                } else {
+                    propagate_stop(x, y, true);
+                }
+            }
         }
+    }
+    return prop;
+}
 
-        if (prop) {
-            std::cout << "tick " << i << ":\n";
-            for (size_t x = 0; x < field.size(); ++x) {
-                std::cout << field[x] << "\n";
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+double Simulator<Ptype, VType, VFlowType, N, M>::velocity_norm() const
+{
+    double norm = 0;
+    const size_t count = field[0].size() * deltas.size();
+    std::array<double, M * deltas.size()> row;
+    for (size_t x = 0; x < field.size(); ++x) {
+        fixed_batch::to_double(std::span<const VType>(&velocity.v[x][0][0], count), std::span<double>(row.data(), count));
+        for (size_t i = 0; i < count; ++i) {
+            norm += std::abs(row[i]);
+        }
+    }
+    return norm;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::publish_frame(size_t i)
+{
+    const size_t cols = field[0].size();
+    frames_->begin(i);
+    char* cells = frames_->cells();
+    float* pressure = frames_->pressure();
+    float* speed = frames_->speed();
+    std::array<double, M * deltas.size()> row;
+    for (size_t x = 0; x < field.size(); ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            cells[x * cols + y] = field[x][y];
+        }
+        if (pressure) {
+            fixed_batch::to_double(std::span<const Ptype>(p[x], cols), std::span<double>(row.data(), cols));
+            for (size_t y = 0; y < cols; ++y) {
+                pressure[x * cols + y] = static_cast<float>(row[y]);
+            }
+        }
+        if (speed) {
+            fixed_batch::to_double(std::span<const VType>(&velocity.v[x][0][0], cols * deltas.size()),
+                                   std::span<double>(row.data(), cols * deltas.size()));
+            for (size_t y = 0; y < cols; ++y) {
+                const double* v = &row[y * deltas.size()];
+                double vx = v[1] - v[0];
+                double vy = v[3] - v[2];
+                speed[x * cols + y] = static_cast<float>(std::sqrt(vx * vx + vy * vy));
+            }
+        }
+    }
+    frames_->publish();
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::finish_tick(size_t i, bool prop, size_t moved, Ptype total_delta_p)
+{
+    tick_ = i + 1;
+    if (history_) {
+        record_history();
+    }
+    if (config_.save_interval != 0 && (i + 1) % config_.save_interval == 0) {
+        saveToJson(config_.output_file);
+    }
+    if (config_.snapshot_interval != 0 && (i + 1) % config_.snapshot_interval == 0) {
+        save_snapshot(config_.snapshot_file);
+    }
+    if (frames_) {
+        publish_frame(i);
+    }
+
+    if (prop && config_.verbose) {
+        std::cout << "tick " << i << ":\n";
+        for (size_t x = 0; x < field.size(); ++x) {
+            std::cout << field[x] << "\n";
+        }
+    }
+
+    if (steady_.enabled() && steady_.update(static_cast<double>(total_delta_p) / open_cells_, moved, velocity_norm())) {
+        if (config_.verbose) {
+            std::cout << "Стационарное состояние достигнуто на такте " << i << "\n";
+        }
+        return true;
+    }
+    if (config_.time_limit > 0) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started_;
+        if (elapsed.count() >= config_.time_limit) {
+            if (config_.verbose) {
+                std::cout << "Лимит времени исчерпан на такте " << i << "\n";
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::record_history()
+{
+    if (!rng_base_ || rng_draws_ >= (1 << 16)) {
+        rng_base_ = std::make_shared<const std::mt19937>(random_generator_);
+        rng_draws_ = 0;
+    }
+    history_->capture(tick_, {rng_base_, rng_draws_, flow_warm_});
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::rewind(size_t tick)
+{
+    const RngMark* mark = history_ ? history_->restore(tick) : nullptr;
+    if (!mark) {
+        std::cerr << "Ошибка: такта " << tick << " нет в истории" << std::endl;
+        return false;
+    }
+    random_generator_ = *mark->base;
+    rng_base_ = mark->base;
+    rng_draws_ = 0;
+    for (uint64_t i = 0; i < mark->draws; ++i) {
+        random01();
+    }
+    tick_ = tick;
+    flow_warm_ = mark->flow_warm;
+    touch_all();
+    steady_ = SteadyStateMonitor(config_.steady_window, config_.steady_eps, config_.steady_moves);
+    return true;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::reseed(unsigned seed)
+{
+    random_generator_.seed(seed);
+    if (history_) {
+        rng_base_.reset();
+        record_history();
+    }
+}
+
+// Повтор из истории по параметрам replay_* конфигурации.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+size_t Simulator<Ptype, VType, VFlowType, N, M>::replay()
+{
+    if (!rewind(*config_.rewind_to)) {
+        return 0;
+    }
+    if (config_.replay_g) {
+        set_gravity(*config_.replay_g);
+    }
+    for (auto [type, rho] : config_.replay_rho) {
+        set_density(type, rho);
+    }
+    if (config_.replay_seed) {
+        reseed(*config_.replay_seed);
+    }
+    if (config_.verbose) {
+        std::cout << "Повтор с такта " << tick_ << std::endl;
+    }
+    return step(config_.replay_ticks != 0 ? config_.replay_ticks : config_.T - std::min(tick_, config_.T));
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+size_t Simulator<Ptype, VType, VFlowType, N, M>::run_simulation(const SimulationConfig& config)
+{
+    if (config.workers > 1) {
+        configure(config);
+        reset();
+        size_t ticks = run_decomposed();
+        if constexpr (checked_arithmetic) {
+            fixed_telemetry::report(std::cout);
+        }
+        return ticks;
+    }
+    if (!load(config)) {
+        return 0;
+    }
+
+    size_t ticks = step(config_.T);
+    if (config_.rewind_to) {
+        ticks += replay();
+    }
+    if (history_) {
+        HistoryStats stats = history_->stats();
+        std::cout << "История: " << stats.entries << " тактов, " << stats.tiles << " плиток, "
+                  << stats.tile_bytes / 1024 << " КБ против " << stats.full_bytes / 1024 << " КБ полных копий\n";
+    }
+    if (snapshot_stats_.count > 0) {
+        std::cout << "Снимков: " << snapshot_stats_.count << ", " << snapshot_stats_.raw_bytes << " -> "
+                  << snapshot_stats_.compressed_bytes << " байт, сжатие " << snapshot_stats_.ratio()
+                  << " раз, " << snapshot_stats_.mb_per_s() << " МБ/с\n";
+    }
+    if constexpr (checked_arithmetic) {
+        fixed_telemetry::report(std::cout);
+    }
+    if (config_.verbose) {
+        std::cout << "end" << std::endl;
+    }
+    return ticks;
+}
+
+// Скорость velocity.v[x][y][k] изменилась. Клетка попадает в changed один
+// раз до ближайшей фазы потока; без --incremental-flow список не нужен.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::touch(int x, int y, size_t k, std::vector<std::pair<int, int>>& changed)
+{
+    uint8_t& mark = touched_[x][y][k];
+    if constexpr (!compact_state) {
+        mark |= move_touched;
+    }
+    if (!(mark & flow_touched) && config_.incremental_flow) {
+        mark |= flow_touched;
+        changed.emplace_back(x, y);
+    }
+}
+
+// Скорости поменялись целиком (rewind, снимок, полосы в других процессах).
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::touch_all()
+{
+    flow_rescan_ = true;
+    move_stale_ = true;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::clear_touched()
+{
+    for (auto [x, y] : flow_changed_) {
+        for (uint8_t& mark : touched_[x][y]) {
+            mark &= ~flow_touched;
+        }
+    }
+    flow_changed_.clear();
+    flow_rescan_ = false;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::configure(const SimulationConfig& config)
+{
+    config_ = config;
+    fixed_telemetry::reset();
+    steady_ = SteadyStateMonitor(config.steady_window, config.steady_eps, config.steady_moves);
+    started_ = std::chrono::steady_clock::now();
+    tick_ = 0;
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+void Simulator<Ptype, VType, VFlowType, N, M>::reset()
+{
+    std::fill(std::begin(rho_), std::end(rho_), VType{});
+    g_ = VType{};
+    std::fill(&dirs[0][0], &dirs[0][0] + N * M, DirCount{});
+    std::fill(&p[0][0], &p[0][0] + N * M, Ptype{});
+    field = {};
+    open_cells_ = 0;
+    velocity = {};
+    velocity_flow = {};
+    std::fill(&last_use[0][0], &last_use[0][0] + N * M, Epoch{});
+    std::fill(&open_dirs_[0][0], &open_dirs_[0][0] + N * M, uint8_t{});
+    UT = 0;
+    flow_warm_ = false;
+    clear_touched();
+    touch_all();
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::load(const SimulationConfig& config)
+{
+    configure(config);
+    reset();
+    return prepare();
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+bool Simulator<Ptype, VType, VFlowType, N, M>::step()
+{
+    size_t i = tick_++;
+    Ptype total_delta_p = 0;
+    if (pipeline_) {
+        apply_forces_pipelined(total_delta_p);
+    } else {
+        apply_gravity(0, field.size(), flow_changed_);
+
+        apply_pressure(0, field.size(), total_delta_p, flow_changed_);
+    }
+
+    apply_flow(total_delta_p);
+
+    size_t moved = 0;
+    bool prop = apply_move(moved);
+    return !finish_tick(i, prop, moved, total_delta_p);
+}
+
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+size_t Simulator<Ptype, VType, VFlowType, N, M>::step(size_t n)
+{
+    size_t done = 0;
+    while (done < n) {
+        ++done;
+        if (!step()) {
+            break;
+        }
+    }
+    return done;
+}
+
+// Корутина отдаёт номер следующего такта после каждого шага; между
+// итерациями хозяин может читать состояние через cells/pressure/velocity_plane.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+Generator<size_t> Simulator<Ptype, VType, VFlowType, N, M>::ticks(size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        bool running = step();
+        co_yield tick_;
+        if (!running) {
+            break;
+        }
+    }
+}
+
+// FNV-1a по типам клеток и сырым байтам p и скоростей.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+uint64_t Simulator<Ptype, VType, VFlowType, N, M>::state_hash() const
+{
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const auto* ptr = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            hash = (hash ^ ptr[i]) * 1099511628211ULL;
+        }
+    };
+    for (size_t x = 0; x < field.size(); ++x) {
+        for (size_t y = 0; y < field[0].size(); ++y) {
+            char cell = field[x][y];
+            mix(&cell, 1);
+        }
+        mix(p[x], field[0].size() * sizeof(Ptype));
+        mix(velocity.v[x], field[0].size() * sizeof(velocity.v[x][0]));
+    }
+    return hash;
+}
+
+// Поле режется на горизонтальные полосы, по одной на процесс. Гравитация и
+// давление локальны: каждая пара соседних клеток меняется только клеткой с
+// большим давлением, поэтому полосы считаются независимо, если у каждой есть
+// теневые строки соседей. Поток и перемещение обходят поле целиком, их
+// выполняет координатор (ранг 0) между двумя барьерами, поэтому состояние
+// каждый такт целиком проходит через общую память в обе стороны и K процессов
+// не обгоняют один: параллельны только гравитация и давление. Это каркас
+// обмена под MPI, доступный только через SimulationConfig::workers; в
+// командную строку он не выведен, пока поток и перемещение не разбиты по
+// полосам.
+template<typename Ptype, typename VType, typename VFlowType, size_t N, size_t M>
+size_t Simulator<Ptype, VType, VFlowType, N, M>::run_decomposed()
+{
+    if (!prepare()) {
+        return 0;
+    }
+
+    const size_t rows = field.size(), cols = field[0].size();
+    const size_t workers = std::min(config_.workers, rows);
+
+    // Координатор пишет состояние в область in, полосы отвечают в область out,
+    // поэтому чтение теневых строк не пересекается с записью соседей.
+    const size_t state_bytes = sizeof(p) + sizeof(velocity.v);
+    const size_t in_offset = 0, out_offset = state_bytes;
+    const size_t f_offset = 2 * state_bytes;
+    const size_t d_offset = f_offset + N * field.row_bytes;
+    const size_t stop_offset = d_offset + (workers + 1) * sizeof(Ptype);
+    const size_t bytes = stop_offset + sizeof(bool);
+
+    ShmSlabTransport transport;
+    if (!transport.start(bytes, static_cast<int>(workers))) {
+        return 0;
+    }
+
+    auto p_at = [&](size_t base, size_t x) {
+        return base + x * M * sizeof(Ptype);
+    };
+    auto v_at = [&](size_t base, size_t x, size_t y = 0, size_t k = 0) {
+        return base + sizeof(p) + ((x * M + y) * deltas.size() + k) * sizeof(VType);
+    };
+    auto put_rows = [&](size_t base, size_t x_begin, size_t x_end) {
+        transport.put(p_at(base, x_begin), p[x_begin], (x_end - x_begin) * sizeof(p[0]));
+        transport.put(v_at(base, x_begin), velocity.v[x_begin], (x_end - x_begin) * sizeof(velocity.v[0]));
+    };
+    auto get_rows = [&](size_t base, size_t x_begin, size_t x_end) {
+        transport.get(p_at(base, x_begin), p[x_begin], (x_end - x_begin) * sizeof(p[0]));
+        transport.get(v_at(base, x_begin), velocity.v[x_begin], (x_end - x_begin) * sizeof(velocity.v[0]));
+    };
+
+    if (transport.rank() == 0) {
+        put_rows(in_offset, 0, rows);
+        for (size_t x = 0; x < rows; ++x) {
+            transport.put(f_offset + x * field.row_bytes, field.row_data(x), field.row_bytes);
+        }
+        bool alive = transport.barrier();
+
+        size_t ticks = 0;
+        while (alive && ticks < config_.T) {
+            if (!transport.barrier()) {
+                alive = false;
+                break;
+            }
+            size_t i = ticks++;
+            get_rows(out_offset, 0, rows);
+            touch_all();
+            Ptype total_delta_p = 0;
+            for (size_t r = 1; r <= workers; ++r) {
+                Ptype slab_delta_p;
+                transport.get(d_offset + r * sizeof(Ptype), &slab_delta_p, sizeof(Ptype));
+                total_delta_p += slab_delta_p;
+            }
+
+            apply_flow(total_delta_p);
+            size_t moved = 0;
+            bool prop = apply_move(moved);
+            bool stop = finish_tick(i, prop, moved, total_delta_p);
+
+            put_rows(in_offset, 0, rows);
+            for (size_t x = 0; x < rows; ++x) {
+                transport.put(f_offset + x * field.row_bytes, field.row_data(x), field.row_bytes);
+            }
+            transport.put(stop_offset, &stop, sizeof(bool));
+            alive = transport.barrier();
+            if (stop) {
+                break;
             }
         }
+        transport.finish();
+        if (config_.verbose && alive) {
+            std::cout << "end" << std::endl;
+        }
+        return ticks;
     }
-    std::cout << "end" << std::endl;
-}
\ No newline at end of file
+
+    const size_t r = transport.rank();
+    const size_t x0 = rows * (r - 1) / workers, x1 = rows * r / workers;
+    const size_t lo = x0 > 0 ? x0 - 1 : 0, hi = std::min(x1 + 1, rows);
+
+    // Давление строк x0-1, x0, x1-1, x1 до шага давления.
+    std::vector<Ptype> edge_p(4 * M);
+    auto edge = [&](size_t x) {
+        size_t slot = x + 1 == x0 ? 0 : x == x0 ? 1 : x + 1 == x1 ? 2 : 3;
+        return edge_p.data() + slot * M;
+    };
+
+    // Запись на границе полосы принадлежит клетке с большим давлением: только
+    // она меняет скорости пары на шаге давления.
+    auto owned = [&](size_t x, size_t y, size_t k) {
+        if (x + 1 == x0) {
+            return k == 1 && edge(x0)[y] > edge(x)[y];
+        }
+        if (x == x1) {
+            return k == 0 && edge(x1 - 1)[y] > edge(x)[y];
+        }
+        if (k == 0 && x == x0 && x0 > 0) {
+            return !(edge(x - 1)[y] > edge(x)[y]);
+        }
+        if (k == 1 && x + 1 == x1 && x1 < rows) {
+            return !(edge(x + 1)[y] > edge(x)[y]);
+        }
+        return true;
+    };
+
+    bool alive = transport.barrier();
+    for (size_t i = 0; alive && i < config_.T; ++i) {
+        get_rows(in_offset, lo, hi);
+        for (size_t x = lo; x < std::min(x1 + 2, rows); ++x) {
+            transport.get(f_offset + x * field.row_bytes, field.row_data(x), field.row_bytes);
+        }
+
+        Ptype slab_delta_p = 0;
+        apply_gravity(lo, hi, flow_changed_);
+        for (size_t x : {lo, x0, x1 - 1, hi - 1}) {
+            std::copy(p[x], p[x] + M, edge(x));
+        }
+        apply_pressure(x0, x1, slab_delta_p, flow_changed_);
+        clear_touched();
+
+        transport.put(p_at(out_offset, x0), p[x0], (x1 - x0) * sizeof(p[0]));
+        for (size_t x = lo; x < hi; ++x) {
+            if (x > x0 && x + 1 < x1) {
+                transport.put(v_at(out_offset, x), velocity.v[x], sizeof(velocity.v[0]));
+                continue;
+            }
+            for (size_t y = 0; y < cols; ++y) {
+                for (size_t k = 0; k < deltas.size(); ++k) {
+                    if (owned(x, y, k)) {
+                        transport.put(v_at(out_offset, x, y, k), &velocity.v[x][y][k], sizeof(VType));
+                    }
+                }
+            }
+        }
+        transport.put(d_offset + r * sizeof(Ptype), &slab_delta_p, sizeof(Ptype));
+
+        alive = transport.barrier() && transport.barrier();
+
+        bool stop = false;
+        transport.get(stop_offset, &stop, sizeof(bool));
+        if (stop) {
+            break;
+        }
+    }
+    transport.finish();
+    return 0;
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "SlabExchange.h"
+
+// Кольцо кадров в именованной разделяемой памяти: один писатель (симулятор),
+// сколько угодно читателей. Каждый слот защищён seqlock: нечётный счётчик —
+// кадр пишется, 2*k — в слоте лежит кадр k. Читатель копирует слот и
+// перепроверяет счётчик, писатель никогда не ждёт читателей. Кадр в слоте
+// читается и пишется только атомарными словами по 8 байт, поэтому чтение во
+// время записи — не гонка данных, а просто отброшенная копия.
+struct FrameRingHeader {
+    static constexpr uint32_t magic_value = 0x464c5246;
+    static constexpr uint32_t has_pressure = 1;
+    static constexpr uint32_t has_speed = 2;
+
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t slots;
+    uint64_t slot_bytes;
+    std::atomic<uint64_t> head;
+};
+
+struct FrameSlotHeader {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> tick;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic_ref<uint64_t>::required_alignment <= alignof(uint64_t));
+
+// Копирование слов между слотом и локальным буфером с relaxed-атомиками;
+// порядок относительно seq задают барьеры вокруг копирования.
+inline void store_words(uint64_t* shared, const uint64_t* src, size_t words) {
+    for (size_t i = 0; i < words; ++i) {
+        std::atomic_ref<uint64_t>(shared[i]).store(src[i], std::memory_order_relaxed);
+    }
+}
+
+inline void load_words(uint64_t* dst, const uint64_t* shared, size_t words) {
+    for (size_t i = 0; i < words; ++i) {
+        dst[i] = std::atomic_ref<uint64_t>(const_cast<uint64_t&>(shared[i])).load(std::memory_order_relaxed);
+    }
+}
+
+struct Frame {
+    uint64_t number = 0;
+    uint64_t tick = 0;
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<char> cells;
+    std::vector<float> pressure;
+    std::vector<float> speed;
+};
+
+class FrameRingLayout {
+protected:
+    size_t cells_bytes() const {
+        return (header()->rows * header()->cols + 7) / 8 * 8;
+    }
+
+    size_t plane_bytes() const {
+        return (header()->rows * header()->cols * sizeof(float) + 7) / 8 * 8;
+    }
+
+    size_t payload_words() const {
+        return (header()->slot_bytes - sizeof(FrameSlotHeader)) / sizeof(uint64_t);
+    }
+
+    FrameRingHeader* header() const {
+        return reinterpret_cast<FrameRingHeader*>(segment_.data());
+    }
+
+    FrameSlotHeader* slot(uint64_t number) const {
+        size_t index = (number - 1) % header()->slots;
+        return reinterpret_cast<FrameSlotHeader*>(segment_.data() + sizeof(FrameRingHeader) + index * header()->slot_bytes);
+    }
+
+    uint64_t* payload(uint64_t number) const {
+        return reinterpret_cast<uint64_t*>(reinterpret_cast<char*>(slot(number)) + sizeof(FrameSlotHeader));
+    }
+
+    SharedMemorySegment segment_;
+};
+
+class FrameRingWriter : public FrameRingLayout {
+public:
+    bool create(const std::string& name, size_t rows, size_t cols, size_t slots, uint32_t flags) {
+        size_t cells = (rows * cols + 7) / 8 * 8;
+        size_t plane = (rows * cols * sizeof(float) + 7) / 8 * 8;
+        size_t planes = ((flags & FrameRingHeader::has_pressure) != 0) + ((flags & FrameRingHeader::has_speed) != 0);
+        size_t slot_bytes = sizeof(FrameSlotHeader) + cells + planes * plane;
+        if (!segment_.create(name, sizeof(FrameRingHeader) + slots * slot_bytes)) {
+            return false;
+        }
+        auto* h = new (segment_.data()) FrameRingHeader{};
+        h->flags = flags;
+        h->rows = static_cast<uint32_t>(rows);
+        h->cols = static_cast<uint32_t>(cols);
+        h->slots = slots;
+        h->slot_bytes = slot_bytes;
+        for (uint64_t number = 1; number <= slots; ++number) {
+            new (slot(number)) FrameSlotHeader{};
+        }
+        staging_.assign(payload_words(), 0);
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic = FrameRingHeader::magic_value;
+        return true;
+    }
+
+    // Между begin и publish кадр заполняется в локальном буфере, publish
+    // переносит его в слот под seqlock.
+    void begin(uint64_t tick) {
+        tick_ = tick;
+    }
+
+    char* cells() const { return reinterpret_cast<char*>(staging_.data()); }
+
+    float* pressure() const {
+        if (!(header()->flags & FrameRingHeader::has_pressure)) {
+            return nullptr;
+        }
+        return reinterpret_cast<float*>(cells() + cells_bytes());
+    }
+
+    float* speed() const {
+        if (!(header()->flags & FrameRingHeader::has_speed)) {
+            return nullptr;
+        }
+        size_t offset = cells_bytes() + (header()->flags & FrameRingHeader::has_pressure ? plane_bytes() : 0);
+        return reinterpret_cast<float*>(cells() + offset);
+    }
+
+    // Барьер после нечётного seq не даёт записям кадра обогнать его: читатель,
+    // увидевший хоть одно новое слово, увидит и нечётный счётчик.
+    void publish() {
+        ++number_;
+        FrameSlotHeader* s = slot(number_);
+        s->seq.store(2 * number_ - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s->tick.store(tick_, std::memory_order_relaxed);
+        store_words(payload(number_), staging_.data(), staging_.size());
+        s->seq.store(2 * number_, std::memory_order_release);
+        header()->head.store(number_, std::memory_order_release);
+    }
+
+private:
+    mutable std::vector<uint64_t> staging_;
+    uint64_t number_ = 0;
+    uint64_t tick_ = 0;
+};
+
+class FrameRingReader : public FrameRingLayout {
+public:
+    bool attach(const std::string& name) {
+        if (!segment_.attach(name)) {
+            return false;
+        }
+        if (segment_.size() < sizeof(FrameRingHeader) || header()->magic != FrameRingHeader::magic_value) {
+            std::cerr << "Ошибка: " << name << " не является кольцом кадров" << std::endl;
+            segment_.close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    uint64_t latest() const {
+        return header()->head.load(std::memory_order_acquire);
+    }
+
+    // false, если кадр ещё не опубликован или уже перезаписан.
+    bool read(uint64_t number, Frame& frame) const {
+        if (number == 0 || number > latest()) {
+            return false;
+        }
+        const FrameSlotHeader* s = slot(number);
+        uint64_t seq = s->seq.load(std::memory_order_acquire);
+        if (seq != 2 * number) {
+            return false;
+        }
+
+        buffer_.resize(payload_words());
+        uint64_t tick = s->tick.load(std::memory_order_relaxed);
+        load_words(buffer_.data(), payload(number), buffer_.size());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->seq.load(std::memory_order_relaxed) != seq) {
+            return false;
+        }
+
+        frame.rows = header()->rows;
+        frame.cols = header()->cols;
+        frame.tick = tick;
+        size_t cells = frame.rows * frame.cols;
+        const char* data = reinterpret_cast<const char*>(buffer_.data());
+        frame.cells.assign(data, data + cells);
+        data += cells_bytes();
+        frame.pressure.resize(header()->flags & FrameRingHeader::has_pressure ? cells : 0);
+        std::memcpy(frame.pressure.data(), data, frame.pressure.size() * sizeof(float));
+        data += frame.pressure.empty() ? 0 : plane_bytes();
+        frame.speed.resize(header()->flags & FrameRingHeader::has_speed ? cells : 0);
+        std::memcpy(frame.speed.data(), data, frame.speed.size() * sizeof(float));
+        frame.number = number;
+        return true;
+    }
+
+    bool read_latest(Frame& frame) const {
+        for (int attempt = 0; attempt < 16; ++attempt) {
+            uint64_t number = latest();
+            if (number == 0) {
+                return false;
+            }
+            if (read(number, frame)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    mutable std::vector<uint64_t> buffer_;
+};
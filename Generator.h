@@ -0,0 +1,81 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+// Минимальный генератор C++20 (std::generator появился только в C++23).
+// Тело корутины выполняется лениво: до следующего co_yield при каждом ++it.
+template<typename T>
+class Generator {
+public:
+    struct promise_type {
+        T value_;
+        std::exception_ptr error_;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) {
+            value_ = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { error_ = std::current_exception(); }
+    };
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        explicit iterator(std::coroutine_handle<promise_type> handle = nullptr) : handle_(handle) {}
+
+        const T& operator*() const { return handle_.promise().value_; }
+
+        iterator& operator++() {
+            advance(handle_);
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+
+    private:
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    ~Generator() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    iterator begin() {
+        advance(handle_);
+        return iterator(handle_);
+    }
+
+    std::default_sentinel_t end() { return {}; }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    static void advance(std::coroutine_handle<promise_type> handle) {
+        handle.resume();
+        if (handle.promise().error_) {
+            std::rethrow_exception(handle.promise().error_);
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
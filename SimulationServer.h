@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "FluidSimulator.h"
+
+// Буферизованное чтение строк и блоков из сокета.
+class SocketStream {
+public:
+    explicit SocketStream(int fd) : fd_(fd) {}
+
+    bool read_line(std::string& line) {
+        for (;;) {
+            size_t end = buffer_.find('\n', pos_);
+            if (end != std::string::npos) {
+                line.assign(buffer_, pos_, end - pos_);
+                pos_ = end + 1;
+                return true;
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool read_bytes(std::string& out, size_t bytes) {
+        while (buffer_.size() - pos_ < bytes) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out.assign(buffer_, pos_, bytes);
+        pos_ += bytes;
+        return true;
+    }
+
+    bool send(const std::string& text) {
+        size_t sent = 0;
+        while (sent < text.size()) {
+            ssize_t n = ::send(fd_, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        if (pos_ > 0) {
+            buffer_.erase(0, pos_);
+            pos_ = 0;
+        }
+        char chunk[4096];
+        ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    int fd_;
+    std::string buffer_;
+    size_t pos_ = 0;
+};
+
+// Прогретые симуляторы по комбинациям типов. Первый экземпляр каждой
+// комбинации — уже построенная таблица вариантов из main, остальные
+// создаются при одновременных задачах одной комбинации и остаются в пуле.
+template<typename Variant>
+class SimulatorPool {
+public:
+    explicit SimulatorPool(std::vector<Variant>& prototypes) : prototypes_(prototypes), free_(prototypes.size()) {
+        for (size_t i = 0; i < prototypes.size(); ++i) {
+            free_[i].push_back(&prototypes[i]);
+        }
+    }
+
+    Variant* acquire(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_[index].empty()) {
+                Variant* simulator = free_[index].back();
+                free_[index].pop_back();
+                return simulator;
+            }
+        }
+        auto created = std::visit([](const auto& prototype) {
+            using Sim = std::decay_t<decltype(prototype)>;
+            return std::make_unique<Variant>(std::in_place_type<Sim>);
+        }, prototypes_[index]);
+        std::lock_guard<std::mutex> lock(mutex_);
+        owned_.push_back(std::move(created));
+        return owned_.back().get();
+    }
+
+    void release(size_t index, Variant* simulator) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_[index].push_back(simulator);
+    }
+
+private:
+    std::vector<Variant>& prototypes_;
+    std::vector<std::vector<Variant*>> free_;
+    std::vector<std::unique_ptr<Variant>> owned_;
+    std::mutex mutex_;
+};
+
+inline std::atomic<bool> server_stop{false};
+
+// Сервер задач на Unix-сокете. Клиент шлёт строки key=value и строку run:
+//   types=float, float, FIXED<64,15>, 36, 84
+//   ticks=1000
+//   seed=7
+//   progress=100
+//   input=<n>   (следом ровно n байт описания поля) или input-file=path
+//   run
+// В ответ идут строки "progress <такт>", затем "field <строк>" с самими
+// строками поля и последней — "result ticks=... hash=... seconds=..." или
+// "error <сообщение>". По одному соединению можно отправить сколько угодно задач.
+template<typename Variant>
+class SimulationServer {
+public:
+    SimulationServer(std::vector<Variant>& prototypes, const std::unordered_map<std::string, int>& params)
+        : pool_(prototypes), params_(params) {}
+
+    int serve(const std::string& socket_path, size_t workers) {
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (listen_fd < 0 || socket_path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Ошибка: не удалось создать сокет " << socket_path << std::endl;
+            return 1;
+        }
+        std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path.c_str());
+        unlink(socket_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+            std::cerr << "Ошибка: не удалось слушать " << socket_path << std::endl;
+            close(listen_fd);
+            return 1;
+        }
+
+        std::signal(SIGINT, [](int) { server_stop = true; });
+        std::signal(SIGTERM, [](int) { server_stop = true; });
+        std::cout << "Сервер слушает " << socket_path << ", потоков: " << workers << std::endl;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < std::max<size_t>(workers, 1); ++i) {
+            threads.emplace_back([this] { worker(); });
+        }
+
+        pollfd pfd{listen_fd, POLLIN, 0};
+        while (!server_stop) {
+            if (poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_.push_back(fd);
+            ready_.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : active_) {
+                shutdown(fd, SHUT_RDWR);
+            }
+            ready_.notify_all();
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        close(listen_fd);
+        unlink(socket_path.c_str());
+        return 0;
+    }
+
+private:
+    struct Job {
+        std::string types;
+        SimulationConfig config;
+        size_t progress = 0;
+    };
+
+    void worker() {
+        for (;;) {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return server_stop || !connections_.empty(); });
+                if (connections_.empty()) {
+                    return;
+                }
+                fd = connections_.front();
+                connections_.pop_front();
+                active_.push_back(fd);
+            }
+            handle(fd);
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_.erase(std::find(active_.begin(), active_.end(), fd));
+            close(fd);
+        }
+    }
+
+    void handle(int fd) {
+        SocketStream stream(fd);
+        Job job;
+        std::string line;
+        while (!server_stop && stream.read_line(line)) {
+            if (line == "run") {
+                if (!run_job(job, stream)) {
+                    return;
+                }
+                job = Job{};
+                continue;
+            }
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                continue;
+            }
+            std::string key = line.substr(0, eq), value = line.substr(eq + 1);
+            try {
+                if (key == "types") job.types = value;
+                else if (key == "ticks") job.config.T = std::stoul(value);
+                else if (key == "seed") job.config.seed = std::stoul(value);
+                else if (key == "progress") job.progress = std::stoul(value);
+                else if (key == "incremental-flow") job.config.incremental_flow = value == "1";
+                else if (key == "input-file") job.config.input_file = value;
+                else if (key == "input" && !stream.read_bytes(job.config.input_text, std::stoul(value))) return;
+            } catch (const std::exception&) {
+                if (!stream.send("error bad value for " + key + "\n")) {
+                    return;
+                }
+            }
+        }
+    }
+
+    bool run_job(Job& job, SocketStream& stream) {
+        for (char& c : job.types) {
+            if (c == '(') c = '<';
+            else if (c == ')') c = '>';
+        }
+        auto it = params_.find(job.types);
+        if (it == params_.end()) {
+            return stream.send("error no suitable params for " + job.types + "\n");
+        }
+        job.config.verbose = false;
+        job.config.save_interval = 0;
+        job.config.workers = 1;
+
+        size_t index = static_cast<size_t>(it->second);
+        Variant* instance = pool_.acquire(index);
+        bool connected;
+        try {
+            connected = std::visit([&](auto& simulator) { return simulate(simulator, job, stream); }, *instance);
+        } catch (const std::exception& e) {
+            // Экземпляр после исключения годится для следующей задачи: load
+            // сбрасывает всё состояние.
+            connected = stream.send(std::string("error ") + e.what() + "\n");
+        }
+        pool_.release(index, instance);
+        return connected;
+    }
+
+    template<typename Sim>
+    bool simulate(Sim& simulator, const Job& job, SocketStream& stream) {
+        auto start = std::chrono::steady_clock::now();
+        if (!simulator.load(job.config)) {
+            return stream.send("error input rejected\n");
+        }
+        size_t ticks = 0;
+        for ([[maybe_unused]] size_t tick : simulator.ticks(job.config.T)) {
+            ++ticks;
+            if (job.progress != 0 && ticks % job.progress == 0 && !stream.send("progress " + std::to_string(ticks) + "\n")) {
+                return false;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const auto& cells = simulator.cells();
+        std::ostringstream reply;
+        reply << "field " << cells.size() << "\n";
+        for (size_t x = 0; x < cells.size(); ++x) {
+            reply << cells[x] << "\n";
+        }
+        char result[128];
+        std::snprintf(result, sizeof(result), "result ticks=%zu hash=%016llx seconds=%.6f\n", ticks,
+                      static_cast<unsigned long long>(simulator.state_hash()), seconds);
+        reply << result;
+        return stream.send(reply.str());
+    }
+
+    SimulatorPool<Variant> pool_;
+    const std::unordered_map<std::string, int>& params_;
+    std::deque<int> connections_;
+    std::vector<int> active_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Общая память процесса, доступная по имени через shm_open.
+class SharedMemorySegment {
+public:
+    SharedMemorySegment() = default;
+    SharedMemorySegment(const SharedMemorySegment&) = delete;
+    SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+
+    ~SharedMemorySegment() {
+        close();
+    }
+
+    bool create(const std::string& name, size_t bytes) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Ошибка: не удалось создать разделяемую память " << name << std::endl;
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            std::cerr << "Ошибка: не удалось выделить " << bytes << " байт в " << name << std::endl;
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        name_ = name;
+        owner_ = true;
+        return map(fd, bytes, PROT_READ | PROT_WRITE);
+    }
+
+    bool attach(const std::string& name, bool writable = false) {
+        int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+        if (fd < 0) {
+            std::cerr << "Ошибка: разделяемая память " << name << " не найдена" << std::endl;
+            return false;
+        }
+        off_t bytes = lseek(fd, 0, SEEK_END);
+        name_ = name;
+        owner_ = false;
+        return map(fd, static_cast<size_t>(bytes), writable ? PROT_READ | PROT_WRITE : PROT_READ);
+    }
+
+    void unlink() {
+        if (owner_ && !name_.empty()) {
+            shm_unlink(name_.c_str());
+            owner_ = false;
+        }
+    }
+
+    void close() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+            data_ = nullptr;
+        }
+        unlink();
+    }
+
+    char* data() const { return static_cast<char*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    bool map(int fd, size_t bytes, int prot) {
+        void* ptr = mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            std::cerr << "Ошибка: не удалось отобразить " << name_ << std::endl;
+            unlink();
+            return false;
+        }
+        data_ = ptr;
+        size_ = bytes;
+        return true;
+    }
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    std::string name_;
+    bool owner_ = false;
+};
+
+// Обмен строками поля между процессами. Ранг 0 координирует такт, остальные
+// ранги считают свои горизонтальные полосы. Интерфейс повторяет односторонние
+// операции MPI (MPI_Put / MPI_Get / MPI_Win_fence), поэтому разделяемую память
+// можно заменить на MPI, не трогая симулятор.
+class SlabTransport {
+public:
+    virtual ~SlabTransport() = default;
+
+    virtual int rank() const = 0;
+    virtual int ranks() const = 0;
+
+    virtual void put(size_t offset, const void* src, size_t bytes) = 0;
+    virtual void get(size_t offset, void* dst, size_t bytes) = 0;
+    // false, если один из рангов завершился и такт уже не закончить.
+    virtual bool barrier() = 0;
+    virtual void finish() = 0;
+};
+
+class ShmSlabTransport : public SlabTransport {
+public:
+    ShmSlabTransport() = default;
+
+    ~ShmSlabTransport() override {
+        finish();
+    }
+
+    bool start(size_t bytes, int workers) {
+        std::string name = "/fluid-slabs-" + std::to_string(getpid());
+        if (!segment_.create(name, sizeof(SharedBarrier) + bytes)) {
+            return false;
+        }
+        init_barrier();
+
+        ranks_ = workers + 1;
+        parent_ = getpid();
+        std::cout.flush();
+        for (int r = 1; r < ranks_; ++r) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "Ошибка: не удалось запустить процесс полосы " << r << std::endl;
+                abort_children();
+                destroy_barrier();
+                segment_.close();
+                return false;
+            }
+            if (pid == 0) {
+                rank_ = r;
+                children_.clear();
+                return true;
+            }
+            children_.push_back(pid);
+        }
+        segment_.unlink();
+        return true;
+    }
+
+    int rank() const override { return rank_; }
+    int ranks() const override { return ranks_; }
+
+    void put(size_t offset, const void* src, size_t bytes) override {
+        std::memcpy(data() + offset, src, bytes);
+    }
+
+    void get(size_t offset, void* dst, size_t bytes) override {
+        std::memcpy(dst, data() + offset, bytes);
+    }
+
+    // Барьер на мьютексе и условной переменной в общей памяти: в отличие от
+    // pthread_barrier_t его ожидание ограничено по времени. Проснувшись по
+    // таймауту, координатор проверяет waitpid(WNOHANG), не умерла ли полоса,
+    // а полоса — не сменился ли родитель. Тогда барьер помечается сломанным и
+    // все ранги выходят из ожидания с false.
+    bool barrier() override {
+        SharedBarrier& b = shared();
+        if (!lock(b)) {
+            return false;
+        }
+        const unsigned generation = b.generation;
+        if (++b.waiting == static_cast<unsigned>(ranks_)) {
+            b.waiting = 0;
+            ++b.generation;
+            pthread_cond_broadcast(&b.cond);
+        }
+        while (b.generation == generation && !b.failed) {
+            timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += 100'000'000;
+            if (deadline.tv_nsec >= 1'000'000'000) {
+                ++deadline.tv_sec;
+                deadline.tv_nsec -= 1'000'000'000;
+            }
+            int rc = pthread_cond_timedwait(&b.cond, &b.mutex, &deadline);
+            if (rc == EOWNERDEAD) {
+                pthread_mutex_consistent(&b.mutex);
+                b.failed = true;
+            } else if (rc == ETIMEDOUT && peer_died()) {
+                b.failed = true;
+            }
+            if (b.failed) {
+                pthread_cond_broadcast(&b.cond);
+            }
+        }
+        const bool passed = b.generation != generation;
+        pthread_mutex_unlock(&b.mutex);
+        return passed;
+    }
+
+    void finish() override {
+        if (segment_.data() == nullptr) {
+            return;
+        }
+        if (rank_ != 0) {
+            _exit(0);
+        }
+        if (shared().failed) {
+            abort_children();
+        }
+        for (pid_t pid : children_) {
+            waitpid(pid, nullptr, 0);
+        }
+        children_.clear();
+        destroy_barrier();
+        segment_.close();
+    }
+
+private:
+    struct SharedBarrier {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        unsigned waiting;
+        unsigned generation;
+        bool failed;
+    };
+
+    SharedBarrier& shared() const {
+        return *reinterpret_cast<SharedBarrier*>(segment_.data());
+    }
+
+    char* data() const {
+        return segment_.data() + sizeof(SharedBarrier);
+    }
+
+    void init_barrier() {
+        SharedBarrier& b = shared();
+        pthread_mutexattr_t mutex_attr;
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&b.mutex, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_t cond_attr;
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&b.cond, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+
+        b.waiting = 0;
+        b.generation = 0;
+        b.failed = false;
+    }
+
+    void destroy_barrier() {
+        pthread_cond_destroy(&shared().cond);
+        pthread_mutex_destroy(&shared().mutex);
+    }
+
+    // Ранг, умерший с захваченным мьютексом, оставляет его в EOWNERDEAD.
+    bool lock(SharedBarrier& b) {
+        if (pthread_mutex_lock(&b.mutex) == EOWNERDEAD) {
+            pthread_mutex_consistent(&b.mutex);
+            b.failed = true;
+            pthread_cond_broadcast(&b.cond);
+        }
+        if (b.failed) {
+            pthread_mutex_unlock(&b.mutex);
+            return false;
+        }
+        return true;
+    }
+
+    bool peer_died() {
+        if (rank_ != 0) {
+            return getppid() != parent_;
+        }
+        for (size_t i = 0; i < children_.size(); ++i) {
+            int status = 0;
+            if (waitpid(children_[i], &status, WNOHANG) == children_[i]) {
+                std::cerr << "Ошибка: процесс полосы " << i + 1 << " завершился";
+                if (WIFSIGNALED(status)) {
+                    std::cerr << " по сигналу " << WTERMSIG(status);
+                } else {
+                    std::cerr << " с кодом " << WEXITSTATUS(status);
+                }
+                std::cerr << ", расчёт прерван" << std::endl;
+                children_.erase(children_.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void abort_children() {
+        for (pid_t child : children_) {
+            kill(child, SIGKILL);
+            waitpid(child, nullptr, 0);
+        }
+        children_.clear();
+    }
+
+    SharedMemorySegment segment_;
+    std::vector<pid_t> children_;
+    pid_t parent_ = 0;
+    int rank_ = 0;
+    int ranks_ = 1;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "fixed.h"
+
+// Сырое целочисленное представление значений плоскостей: для FIXED/FAST_FIXED
+// это поле v, для float/double — биты числа. Кодек работает только с ним, поэтому
+// снимок восстанавливает состояние бит в бит.
+template<typename T>
+struct PlaneTraits;
+
+template<>
+struct PlaneTraits<float> {
+    using Raw = uint32_t;
+    static constexpr uint8_t kind = 'f';
+    static constexpr uint8_t frac_bits = 0;
+    static Raw to_raw(float value) { return std::bit_cast<Raw>(value); }
+    static float from_raw(Raw raw) { return std::bit_cast<float>(raw); }
+};
+
+template<>
+struct PlaneTraits<double> {
+    using Raw = uint64_t;
+    static constexpr uint8_t kind = 'd';
+    static constexpr uint8_t frac_bits = 0;
+    static Raw to_raw(double value) { return std::bit_cast<Raw>(value); }
+    static double from_raw(Raw raw) { return std::bit_cast<double>(raw); }
+};
+
+template<size_t N, size_t K, typename Tag>
+struct PlaneTraits<FixedPoint<N, K, Tag>> {
+    using Value = FixedPoint<N, K, Tag>;
+    using Raw = std::make_unsigned_t<typename Value::StorageType>;
+    static constexpr uint8_t kind = std::is_same_v<Tag, FastTag> ? 'F' : 'X';
+    static constexpr uint8_t frac_bits = K;
+    static Raw to_raw(const Value& value) { return static_cast<Raw>(value.v); }
+    static Value from_raw(Raw raw) { return Value::from_raw(static_cast<typename Value::StorageType>(raw)); }
+};
+
+class SnapshotWriter {
+public:
+    void put_bytes(const void* data, size_t bytes) {
+        out_.append(static_cast<const char*>(data), bytes);
+    }
+
+    template<typename Int>
+    void put(Int value) {
+        put_bytes(&value, sizeof(value));
+    }
+
+    void put_varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    // Типы клеток: пары (символ, длина серии).
+    void put_runs(const char* cells, size_t count) {
+        for (size_t i = 0; i < count;) {
+            size_t run = 1;
+            while (i + run < count && cells[i + run] == cells[i]) {
+                ++run;
+            }
+            out_.push_back(cells[i]);
+            put_varint(run);
+            i += run;
+        }
+    }
+
+    // Плоскость: разность с предыдущим значением, zigzag и упаковка блоками
+    // по block значений с общей шириной в битах.
+    template<typename Raw>
+    void put_plane(const Raw* values, size_t count) {
+        static_assert(std::is_unsigned_v<Raw>);
+        using Signed = std::make_signed_t<Raw>;
+        constexpr unsigned width = sizeof(Raw) * 8;
+
+        uint64_t zigzag[block];
+        Raw prev = 0;
+        for (size_t begin = 0; begin < count; begin += block) {
+            size_t n = std::min(block, count - begin);
+            uint64_t all = 0;
+            for (size_t i = 0; i < n; ++i) {
+                auto delta = static_cast<Signed>(static_cast<Raw>(values[begin + i] - prev));
+                prev = values[begin + i];
+                zigzag[i] = static_cast<Raw>((static_cast<Raw>(delta) << 1) ^ static_cast<Raw>(delta >> (width - 1)));
+                all |= zigzag[i];
+            }
+            uint8_t bits = static_cast<uint8_t>(std::bit_width(all));
+            out_.push_back(static_cast<char>(bits));
+            pack(zigzag, n, bits);
+        }
+    }
+
+    const std::string& data() const { return out_; }
+    size_t size() const { return out_.size(); }
+
+    static constexpr size_t block = 64;
+
+private:
+    void pack(const uint64_t* values, size_t count, uint8_t bits) {
+        unsigned __int128 acc = 0;
+        unsigned filled = 0;
+        for (size_t i = 0; i < count; ++i) {
+            acc |= static_cast<unsigned __int128>(values[i]) << filled;
+            filled += bits;
+            while (filled >= 8) {
+                out_.push_back(static_cast<char>(acc & 0xff));
+                acc >>= 8;
+                filled -= 8;
+            }
+        }
+        if (filled > 0) {
+            out_.push_back(static_cast<char>(acc & 0xff));
+        }
+    }
+
+    std::string out_;
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+    bool ok() const { return ok_; }
+
+    bool get_bytes(void* dst, size_t bytes) {
+        if (!ok_ || size_ - pos_ < bytes) {
+            return ok_ = false;
+        }
+        std::memcpy(dst, data_ + pos_, bytes);
+        pos_ += bytes;
+        return true;
+    }
+
+    template<typename Int>
+    Int get() {
+        Int value{};
+        get_bytes(&value, sizeof(value));
+        return value;
+    }
+
+    uint64_t get_varint() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = get<uint8_t>();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    bool get_runs(char* cells, size_t count) {
+        for (size_t i = 0; i < count && ok_;) {
+            char cell = get<char>();
+            uint64_t run = get_varint();
+            if (run == 0 || run > count - i) {
+                return ok_ = false;
+            }
+            std::memset(cells + i, cell, run);
+            i += run;
+        }
+        return ok_;
+    }
+
+    template<typename Raw>
+    bool get_plane(Raw* values, size_t count) {
+        constexpr size_t block = SnapshotWriter::block;
+        uint64_t zigzag[block];
+        Raw prev = 0;
+        for (size_t begin = 0; begin < count && ok_; begin += block) {
+            size_t n = std::min(block, count - begin);
+            uint8_t bits = get<uint8_t>();
+            if (bits > sizeof(Raw) * 8 || !unpack(zigzag, n, bits)) {
+                return ok_ = false;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                auto delta = static_cast<Raw>((zigzag[i] >> 1) ^ (~(zigzag[i] & 1) + 1));
+                prev = static_cast<Raw>(prev + delta);
+                values[begin + i] = prev;
+            }
+        }
+        return ok_;
+    }
+
+private:
+    bool unpack(uint64_t* values, size_t count, uint8_t bits) {
+        size_t bytes = (count * bits + 7) / 8;
+        if (size_ - pos_ < bytes) {
+            return false;
+        }
+        const auto* src = reinterpret_cast<const unsigned char*>(data_ + pos_);
+        uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        unsigned __int128 acc = 0;
+        unsigned filled = 0;
+        size_t next = 0;
+        for (size_t i = 0; i < count; ++i) {
+            while (filled < bits) {
+                acc |= static_cast<unsigned __int128>(src[next++]) << filled;
+                filled += 8;
+            }
+            values[i] = static_cast<uint64_t>(acc) & mask;
+            acc >>= bits;
+            filled -= bits;
+        }
+        pos_ += bytes;
+        return true;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+struct SnapshotStats {
+    size_t count = 0;
+    size_t raw_bytes = 0;
+    size_t compressed_bytes = 0;
+    double seconds = 0;
+
+    double ratio() const {
+        return compressed_bytes == 0 ? 0 : static_cast<double>(raw_bytes) / compressed_bytes;
+    }
+
+    double mb_per_s() const {
+        return seconds == 0 ? 0 : raw_bytes / seconds / (1 << 20);
+    }
+};
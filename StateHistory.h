@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Пул плиток одного размера со счётчиком ссылок. Память берётся кусками по
+// tiles_per_chunk плиток и до уничтожения пула не возвращается: освобождённые
+// плитки уходят в список свободных и переиспользуются следующими тактами.
+class TilePool {
+public:
+    struct Tile {
+        size_t refs;
+        Tile* next_free;
+
+        unsigned char* data() { return reinterpret_cast<unsigned char*>(this + 1); }
+    };
+
+    explicit TilePool(size_t tile_bytes, size_t tiles_per_chunk = 256)
+        : stride_((sizeof(Tile) + tile_bytes + alignof(Tile) - 1) / alignof(Tile) * alignof(Tile)),
+          tiles_per_chunk_(tiles_per_chunk) {}
+
+    TilePool(const TilePool&) = delete;
+    TilePool& operator=(const TilePool&) = delete;
+
+    Tile* allocate() {
+        if (!free_) {
+            chunks_.push_back(std::make_unique<unsigned char[]>(stride_ * tiles_per_chunk_));
+            for (size_t i = tiles_per_chunk_; i-- > 0;) {
+                auto* tile = reinterpret_cast<Tile*>(chunks_.back().get() + i * stride_);
+                tile->next_free = free_;
+                free_ = tile;
+            }
+        }
+        Tile* tile = free_;
+        free_ = tile->next_free;
+        tile->refs = 1;
+        ++live_;
+        return tile;
+    }
+
+    void retain(Tile* tile) { ++tile->refs; }
+
+    void release(Tile* tile) {
+        if (--tile->refs == 0) {
+            tile->next_free = free_;
+            free_ = tile;
+            --live_;
+        }
+    }
+
+    size_t live() const { return live_; }
+    size_t reserved_bytes() const { return chunks_.size() * tiles_per_chunk_ * stride_; }
+
+private:
+    size_t stride_;
+    size_t tiles_per_chunk_;
+    std::vector<std::unique_ptr<unsigned char[]>> chunks_;
+    Tile* free_ = nullptr;
+    size_t live_ = 0;
+};
+
+// Двумерный массив байт, который история режет на плитки.
+struct HistoryPlane {
+    unsigned char* data;
+    size_t rows;
+    size_t row_bytes;
+    size_t stride;
+};
+
+struct HistoryStats {
+    size_t entries = 0;
+    size_t tiles = 0;
+    size_t tile_bytes = 0;
+    size_t reserved_bytes = 0;
+    size_t full_bytes = 0;
+};
+
+// История состояний по тактам с копированием при записи. Каждая плоскость
+// режется на плитки tile_rows x tile_row_bytes; при записи такта плитка,
+// совпавшая с плиткой предыдущего такта, не копируется, а разделяется с ним.
+// Extra — то, что хранится при записи целиком (например, положение генератора).
+template<typename Extra>
+class TiledHistory {
+public:
+    static constexpr size_t tile_rows = 8;
+    static constexpr size_t tile_row_bytes = 64;
+    static constexpr size_t tile_bytes = tile_rows * tile_row_bytes;
+
+    TiledHistory() = default;
+    TiledHistory(const TiledHistory&) = delete;
+    TiledHistory& operator=(const TiledHistory&) = delete;
+
+    ~TiledHistory() {
+        clear();
+    }
+
+    void start(std::vector<HistoryPlane> planes, size_t limit) {
+        clear();
+        planes_ = std::move(planes);
+        limit_ = limit;
+        active_ = true;
+    }
+
+    void clear() {
+        while (!entries_.empty()) {
+            drop_back();
+        }
+        planes_.clear();
+        active_ = false;
+    }
+
+    bool active() const { return active_; }
+
+    // Повторная запись того же такта заменяет последнюю запись.
+    void capture(uint64_t tick, Extra extra) {
+        Entry entry{tick, std::move(extra), {}};
+        const Entry* prev = entries_.empty() ? nullptr : &entries_.back();
+        size_t index = 0;
+        for (const auto& plane : planes_) {
+            for (size_t x0 = 0; x0 < plane.rows; x0 += tile_rows) {
+                for (size_t b0 = 0; b0 < plane.row_bytes; b0 += tile_row_bytes, ++index) {
+                    TilePool::Tile* old = prev ? prev->tiles[index] : nullptr;
+                    if (old && same(plane, x0, b0, old)) {
+                        pool_.retain(old);
+                        entry.tiles.push_back(old);
+                        continue;
+                    }
+                    TilePool::Tile* tile = pool_.allocate();
+                    copy_out(plane, x0, b0, tile);
+                    entry.tiles.push_back(tile);
+                }
+            }
+        }
+        if (prev && prev->tick == tick) {
+            drop_back();
+        }
+        entries_.push_back(std::move(entry));
+        while (limit_ != 0 && entries_.size() > limit_) {
+            for (TilePool::Tile* tile : entries_.front().tiles) {
+                pool_.release(tile);
+            }
+            entries_.pop_front();
+        }
+    }
+
+    // Копирует плитки такта tick обратно в плоскости и отбрасывает более
+    // поздние записи. nullptr, если такта в истории нет.
+    const Extra* restore(uint64_t tick) {
+        auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.tick == tick; });
+        if (it == entries_.end()) {
+            return nullptr;
+        }
+        while (&entries_.back() != &*it) {
+            drop_back();
+        }
+        size_t index = 0;
+        for (const auto& plane : planes_) {
+            for (size_t x0 = 0; x0 < plane.rows; x0 += tile_rows) {
+                for (size_t b0 = 0; b0 < plane.row_bytes; b0 += tile_row_bytes, ++index) {
+                    copy_in(plane, x0, b0, entries_.back().tiles[index]);
+                }
+            }
+        }
+        return &entries_.back().extra;
+    }
+
+    uint64_t first_tick() const { return entries_.empty() ? 0 : entries_.front().tick; }
+    uint64_t last_tick() const { return entries_.empty() ? 0 : entries_.back().tick; }
+
+    HistoryStats stats() const {
+        HistoryStats stats;
+        stats.entries = entries_.size();
+        stats.tiles = pool_.live();
+        stats.tile_bytes = pool_.live() * tile_bytes;
+        stats.reserved_bytes = pool_.reserved_bytes();
+        for (const auto& plane : planes_) {
+            stats.full_bytes += plane.rows * plane.row_bytes * entries_.size();
+        }
+        return stats;
+    }
+
+private:
+    struct Entry {
+        uint64_t tick;
+        Extra extra;
+        std::vector<TilePool::Tile*> tiles;
+    };
+
+    static size_t width(const HistoryPlane& plane, size_t b0) {
+        return std::min(tile_row_bytes, plane.row_bytes - b0);
+    }
+
+    static bool same(const HistoryPlane& plane, size_t x0, size_t b0, TilePool::Tile* tile) {
+        const size_t w = width(plane, b0);
+        for (size_t x = x0; x < std::min(x0 + tile_rows, plane.rows); ++x) {
+            if (std::memcmp(plane.data + x * plane.stride + b0, tile->data() + (x - x0) * tile_row_bytes, w) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void copy_out(const HistoryPlane& plane, size_t x0, size_t b0, TilePool::Tile* tile) {
+        const size_t w = width(plane, b0);
+        for (size_t x = x0; x < std::min(x0 + tile_rows, plane.rows); ++x) {
+            std::memcpy(tile->data() + (x - x0) * tile_row_bytes, plane.data + x * plane.stride + b0, w);
+        }
+    }
+
+    static void copy_in(const HistoryPlane& plane, size_t x0, size_t b0, TilePool::Tile* tile) {
+        const size_t w = width(plane, b0);
+        for (size_t x = x0; x < std::min(x0 + tile_rows, plane.rows); ++x) {
+            std::memcpy(plane.data + x * plane.stride + b0, tile->data() + (x - x0) * tile_row_bytes, w);
+        }
+    }
+
+    void drop_back() {
+        for (TilePool::Tile* tile : entries_.back().tiles) {
+            pool_.release(tile);
+        }
+        entries_.pop_back();
+    }
+
+    TilePool pool_{tile_bytes};
+    std::vector<HistoryPlane> planes_;
+    std::deque<Entry> entries_;
+    size_t limit_ = 0;
+    bool active_ = false;
+};
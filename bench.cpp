@@ -0,0 +1,7 @@
+
+#include "Benchmark.h"
+
+int main(int argc, char* argv[]) {
+    std::vector<BenchTarget> targets = { {"float, float, float, 36, 84", 36, 84, &run_bench_case<Simulator<float, float, float, 36, 84>>, &check_batch_types<float, float, float, 36, 84>}, {"float, float, float, 14, 5", 14, 5, &run_bench_case<Simulator<float, float, float, 14, 5>>, &check_batch_types<float, float, float, 14, 5>}, {"float, float, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<float, float, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<float, float, FAST_FIXED<13,7>, 36, 84>}, {"float, float, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<float, float, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<float, float, FAST_FIXED<13,7>, 14, 5>}, {"float, float, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<float, float, FIXED<64,15>, 36, 84>>, &check_batch_types<float, float, FIXED<64,15>, 36, 84>}, {"float, float, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<float, float, FIXED<64,15>, 14, 5>>, &check_batch_types<float, float, FIXED<64,15>, 14, 5>}, {"float, FAST_FIXED<13,7>, float, 36, 84", 36, 84, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, float, 36, 84>>, &check_batch_types<float, FAST_FIXED<13,7>, float, 36, 84>}, {"float, FAST_FIXED<13,7>, float, 14, 5", 14, 5, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, float, 14, 5>>, &check_batch_types<float, FAST_FIXED<13,7>, float, 14, 5>}, {"float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>}, {"float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>}, {"float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>>, &check_batch_types<float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>}, {"float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>>, &check_batch_types<float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>}, {"float, FIXED<64,15>, float, 36, 84", 36, 84, &run_bench_case<Simulator<float, FIXED<64,15>, float, 36, 84>>, &check_batch_types<float, FIXED<64,15>, float, 36, 84>}, {"float, FIXED<64,15>, float, 14, 5", 14, 5, &run_bench_case<Simulator<float, FIXED<64,15>, float, 14, 5>>, &check_batch_types<float, FIXED<64,15>, float, 14, 5>}, {"float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>}, {"float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>}, {"float, FIXED<64,15>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<float, FIXED<64,15>, FIXED<64,15>, 36, 84>>, &check_batch_types<float, FIXED<64,15>, FIXED<64,15>, 36, 84>}, {"float, FIXED<64,15>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<float, FIXED<64,15>, FIXED<64,15>, 14, 5>>, &check_batch_types<float, FIXED<64,15>, FIXED<64,15>, 14, 5>}, {"FAST_FIXED<13,7>, float, float, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, float, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, float, float, 36, 84>}, {"FAST_FIXED<13,7>, float, float, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, float, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, float, float, 14, 5>}, {"FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84>}, {"FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5>}, {"FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84>}, {"FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>}, {"FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84>}, {"FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5>}, {"FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>}, {"FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>}, {"FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84>}, {"FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5>>, &check_batch_types<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5>}, {"FIXED<64,15>, float, float, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, float, float, 36, 84>>, &check_batch_types<FIXED<64,15>, float, float, 36, 84>}, {"FIXED<64,15>, float, float, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, float, float, 14, 5>>, &check_batch_types<FIXED<64,15>, float, float, 14, 5>}, {"FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84>}, {"FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5>}, {"FIXED<64,15>, float, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, float, FIXED<64,15>, 36, 84>>, &check_batch_types<FIXED<64,15>, float, FIXED<64,15>, 36, 84>}, {"FIXED<64,15>, float, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, float, FIXED<64,15>, 14, 5>>, &check_batch_types<FIXED<64,15>, float, FIXED<64,15>, 14, 5>}, {"FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84>}, {"FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5>}, {"FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>}, {"FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>}, {"FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>}, {"FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>>, &check_batch_types<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>}, {"FIXED<64,15>, FIXED<64,15>, float, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, float, 36, 84>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, float, 36, 84>}, {"FIXED<64,15>, FIXED<64,15>, float, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, float, 14, 5>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, float, 14, 5>}, {"FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>}, {"FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>}, {"FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84", 36, 84, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84>}, {"FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5", 14, 5, &run_bench_case<Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5>>, &check_batch_types<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5>} };
+    return run_benchmarks(targets, argc, argv);
+}
@@ -1,9 +1,142 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <iostream>
 #include <type_traits>
 #include <compare>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#ifdef FLUID_CHECKED_ARITHMETIC
+#include <atomic>
+#include <cstring>
+constexpr bool checked_arithmetic = true;
+#else
+constexpr bool checked_arithmetic = false;
+#endif
+
+// Счётчики событий проверяемой арифметики по фазам такта, местам в коде и
+// видам операций. Место задаёт site("...") перед выражением; PhaseScope
+// сбрасывает его при входе и восстанавливает при выходе. Без
+// FLUID_CHECKED_ARITHMETIC остаются пустые заглушки и проверки в FixedPoint
+// не компилируются.
+namespace fixed_telemetry {
+
+enum Phase { Setup, Gravity, Pressure, Flow, Move, PhaseCount };
+enum Op { Add, Sub, Mul, Div, FromInt, FromFloat, FromFixed, ToFloat, OpCount };
+enum Event { Overflow, Saturation, PrecisionLoss, Underflow, EventCount };
+
+#ifdef FLUID_CHECKED_ARITHMETIC
+
+// Место 0 — операции вне размеченных мест. Имена — строковые литералы,
+// одинаковые литералы сравниваются сначала по адресу.
+constexpr size_t max_sites = 64;
+inline std::atomic<const char*> site_names[max_sites];
+inline std::atomic<uint64_t> counters[PhaseCount][max_sites][OpCount][EventCount];
+inline thread_local Phase current_phase = Setup;
+inline thread_local size_t current_site = 0;
+
+inline size_t site_id(const char* name) {
+    for (size_t i = 1; i < max_sites; ++i) {
+        const char* known = site_names[i].load(std::memory_order_acquire);
+        if (known == name) {
+            return i;
+        }
+        if (known == nullptr) {
+            break;
+        }
+    }
+    for (size_t i = 1; i < max_sites; ++i) {
+        const char* known = site_names[i].load(std::memory_order_acquire);
+        if (known == nullptr && site_names[i].compare_exchange_strong(known, name, std::memory_order_acq_rel)) {
+            return i;
+        }
+        if (known == name || std::strcmp(known, name) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+inline void site(const char* name) {
+    current_site = site_id(name);
+}
+
+inline void record(Op op, Event event) {
+    counters[current_phase][current_site][op][event].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void reset() {
+    for (auto& phase : counters) {
+        for (auto& site : phase) {
+            for (auto& op : site) {
+                for (auto& counter : op) {
+                    counter.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+inline void report(std::ostream& os) {
+    static const char* phases[] = {"подготовка", "гравитация", "давление", "поток", "перемещение"};
+    static const char* ops[] = {"+", "-", "*", "/", "из int", "из float/double", "из другого FIXED", "в float/double"};
+    os << "Проверка арифметики (переполнение / насыщение / потеря точности / обнуление):\n";
+    bool any = false;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        for (size_t site = 0; site < max_sites; ++site) {
+            for (int op = 0; op < OpCount; ++op) {
+                const auto& c = counters[phase][site][op];
+                if (c[Overflow] + c[Saturation] + c[PrecisionLoss] + c[Underflow] == 0) {
+                    continue;
+                }
+                any = true;
+                os << "  " << phases[phase] << ", ";
+                if (site != 0) {
+                    os << site_names[site].load(std::memory_order_acquire) << ", ";
+                }
+                os << ops[op] << ": " << c[Overflow] << " / " << c[Saturation]
+                   << " / " << c[PrecisionLoss] << " / " << c[Underflow] << "\n";
+            }
+        }
+    }
+    if (!any) {
+        os << "  событий нет\n";
+    }
+}
+
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase phase) : saved_(current_phase), saved_site_(current_site) {
+        current_phase = phase;
+        current_site = 0;
+    }
+    ~PhaseScope() {
+        current_phase = saved_;
+        current_site = saved_site_;
+    }
+
+private:
+    Phase saved_;
+    size_t saved_site_;
+};
+
+#else
+
+inline void site(const char*) {}
+inline void record(Op, Event) {}
+inline void reset() {}
+inline void report(std::ostream&) {}
+
+struct PhaseScope {
+    explicit PhaseScope(Phase) {}
+};
+
+#endif
+
+}
 
 struct FixedTag {};
 struct FastTag {};
@@ -43,19 +176,85 @@ struct FixedPoint {
 
     FixedPoint() : v(0) {}
 
+private:
+    static constexpr bool fits(__int128 wide) {
+        return wide >= std::numeric_limits<StorageType>::min() && wide <= std::numeric_limits<StorageType>::max();
+    }
+
+    static constexpr void record(fixed_telemetry::Op op, fixed_telemetry::Event event) {
+        if (!std::is_constant_evaluated()) {
+            fixed_telemetry::record(op, event);
+        }
+    }
+
+    // Перевод уже умноженного на 2^K значения в StorageType. В режиме проверок
+    // значение вне диапазона насыщается, иначе приведение не определено.
+    static constexpr StorageType from_scaled(double scaled, double source, fixed_telemetry::Op op) {
+        if constexpr (checked_arithmetic) {
+            using namespace fixed_telemetry;
+            if (!(scaled >= static_cast<double>(std::numeric_limits<StorageType>::min())
+                  && scaled < -static_cast<double>(std::numeric_limits<StorageType>::min()))) {
+                record(op, Saturation);
+                if (scaled != scaled) {
+                    return 0;
+                }
+                return scaled < 0 ? std::numeric_limits<StorageType>::min() : std::numeric_limits<StorageType>::max();
+            }
+            auto result = static_cast<StorageType>(scaled);
+            if (static_cast<double>(result) != scaled) {
+                record(op, PrecisionLoss);
+                if (result == 0 && source != 0) {
+                    record(op, Underflow);
+                }
+            }
+            return result;
+        }
+        return static_cast<StorageType>(scaled);
+    }
+
+    static constexpr void check_add(StorageType a, StorageType b, fixed_telemetry::Op op) {
+        if constexpr (checked_arithmetic) {
+            StorageType result;
+            bool overflow = op == fixed_telemetry::Add ? __builtin_add_overflow(a, b, &result) : __builtin_sub_overflow(a, b, &result);
+            if (overflow) {
+                record(op, fixed_telemetry::Overflow);
+            }
+        }
+    }
+
+    // Потеря точности при переводе в float/double: результат, умноженный
+    // обратно на 2^K, не даёт исходное сырое значение.
+    template <typename Float>
+    void check_round_trip(Float result) const {
+        if constexpr (checked_arithmetic) {
+            double scaled = std::ldexp(static_cast<double>(result), K);
+            if (scaled != std::trunc(scaled) || static_cast<__int128>(scaled) != v) {
+                record(fixed_telemetry::ToFloat, fixed_telemetry::PrecisionLoss);
+            }
+        }
+    }
+
+public:
+
         friend std::ostream& operator<<(std::ostream& os, const FixedPoint& fp) {
         os << static_cast<double>(fp);
         return os;
         }
 
     constexpr FixedPoint(int32_t value) 
-        : v(static_cast<StorageType>(value) << K) {}
+        : v(static_cast<StorageType>(value) << K) {
+        if constexpr (checked_arithmetic) {
+            if (!fits(static_cast<__int128>(value) << K)) {
+                record(fixed_telemetry::FromInt, fixed_telemetry::Overflow);
+            }
+        }
+    }
 
     constexpr FixedPoint(float f) 
-        : v(static_cast<StorageType>(f * (1ULL << K))) {}
+        : v(from_scaled(f * (1ULL << K), f, fixed_telemetry::FromFloat)) {}
 
     constexpr FixedPoint(double f) 
-        : v(static_cast<StorageType>(f * (1ULL << K))) {}
+        : v(from_scaled(f * (1ULL << K), f, fixed_telemetry::FromFloat)) {}
 
     constexpr FixedPoint(RawTag, StorageType raw) 
         : v(raw) {}
@@ -63,13 +262,13 @@ struct FixedPoint {
     template <size_t M, size_t L, typename OtherTag>
     constexpr FixedPoint(const FixedPoint<M, L, OtherTag>& other) {
         double asDouble = static_cast<double>(other);
-        v = static_cast<StorageType>(asDouble * (1ULL << K));
+        v = from_scaled(asDouble * (1ULL << K), asDouble, fixed_telemetry::FromFixed);
     }
 
     template <size_t M, size_t L, typename OtherTag>
     FixedPoint& operator=(const FixedPoint<M, L, OtherTag>& other) {
         double asDouble = static_cast<double>(other);
-        v = static_cast<StorageType>(asDouble * (1ULL << K));
+        v = from_scaled(asDouble * (1ULL << K), asDouble, fixed_telemetry::FromFixed);
         return *this;
     }
 
@@ -79,11 +278,15 @@ public:
     }
 
     explicit operator float() const {
-        return static_cast<float>(v) / (1ULL << K);
+        float result = static_cast<float>(v) / (1ULL << K);
+        check_round_trip(result);
+        return result;
     }
 
     explicit operator double() const {
-        return static_cast<double>(v) / (1ULL << K);
+        double result = static_cast<double>(v) / (1ULL << K);
+        check_round_trip(result);
+        return result;
     }
 
     template <typename Integral, typename = std::enable_if_t<std::is_integral_v<Integral>>>
@@ -96,12 +299,14 @@ public:
     FixedPoint& operator=(const FixedPoint& other) = default;
 
     FixedPoint operator+(const FixedPoint& other) const {
+        check_add(v, other.v, fixed_telemetry::Add);
         FixedPoint result;
         result.v = this->v + other.v;
         return result;
     }
 
     FixedPoint operator-(const FixedPoint& other) const {
+        check_add(v, other.v, fixed_telemetry::Sub);
         FixedPoint result;
         result.v = this->v - other.v;
         return result;
@@ -112,6 +317,19 @@ public:
             (N <= 16), int_fast32_t,
             int_fast64_t
         >;
+        if constexpr (checked_arithmetic) {
+            using namespace fixed_telemetry;
+            __int128 wide = static_cast<__int128>(v) * other.v;
+            if (wide < std::numeric_limits<IntermediateType>::min() || wide > std::numeric_limits<IntermediateType>::max()
+                || !fits(wide >> K)) {
+                record(Mul, Overflow);
+            } else if (wide & ((__int128(1) << K) - 1)) {
+                record(Mul, PrecisionLoss);
+                if ((wide >> K) == 0) {
+                    record(Mul, Underflow);
+                }
+            }
+        }
         IntermediateType temp = static_cast<IntermediateType>(v) * static_cast<IntermediateType>(other.v);
         FixedPoint result;
         result.v = static_cast<StorageType>(temp >> K);
@@ -123,6 +341,19 @@ public:
             (N <= 16), int_fast32_t,
             int_fast64_t
         >;
+        if constexpr (checked_arithmetic) {
+            using namespace fixed_telemetry;
+            __int128 wide = static_cast<__int128>(v) << K;
+            if (other.v == 0 || wide < std::numeric_limits<IntermediateType>::min()
+                || wide > std::numeric_limits<IntermediateType>::max() || !fits(wide / other.v)) {
+                record(Div, Overflow);
+            } else if (wide % other.v != 0) {
+                record(Div, PrecisionLoss);
+                if (wide / other.v == 0) {
+                    record(Div, Underflow);
+                }
+            }
+        }
         IntermediateType temp = (static_cast<IntermediateType>(v) << K) / other.v;
         FixedPoint result;
         result.v = static_cast<StorageType>(temp);
@@ -130,11 +361,13 @@ public:
     }
 
     FixedPoint& operator+=(const FixedPoint& other) {
+        check_add(v, other.v, fixed_telemetry::Add);
         this->v += other.v;
         return *this;
     }
 
     FixedPoint& operator-=(const FixedPoint& other) {
+        check_add(v, other.v, fixed_telemetry::Sub);
         this->v -= other.v;
         return *this;
     }
@@ -482,4 +715,162 @@ bool operator>(double lhs, const FixedPoint<N, K>& rhs) {
 template <size_t N, size_t K, typename Tag>
 inline bool operator>(double lhs, const FixedPoint<N, K, Tag>& rhs) {
     return lhs > static_cast<double>(rhs);
-}
\ No newline at end of file
+}
+
+// Пакетные операции над массивами значений. Для FixedPoint циклы идут по
+// сырым целым StorageType без ветвлений и переходов через float/double,
+// поэтому компилятор их векторизует; для float и double — те же операции
+// обычной арифметикой, так что код симулятора может звать их для любого типа.
+// В режиме FLUID_CHECKED_ARITHMETIC сложение, умножение и деление идут через
+// скалярные операторы, чтобы события попадали в счётчики.
+namespace fixed_batch {
+
+template <typename T>
+struct traits {
+    static constexpr bool is_fixed = false;
+};
+
+template <size_t N, size_t K, typename Tag>
+struct traits<FixedPoint<N, K, Tag>> {
+    static constexpr bool is_fixed = true;
+    static constexpr size_t frac_bits = K;
+    using Wide = std::conditional_t<(N <= 16), int_fast32_t, int_fast64_t>;
+    static constexpr size_t storage_bits = sizeof(typename FixedPoint<N, K, Tag>::StorageType) * 8;
+    using Reciprocal = std::conditional_t<(storage_bits <= 32), int64_t, __int128>;
+};
+
+// dst[i] += src[i]
+template <typename T>
+void add(std::span<T> dst, std::type_identity_t<std::span<const T>> src) {
+    if constexpr (traits<T>::is_fixed && !checked_arithmetic) {
+        for (size_t i = 0; i < dst.size(); ++i) {
+            dst[i].v += src[i].v;
+        }
+    } else {
+        for (size_t i = 0; i < dst.size(); ++i) {
+            dst[i] += src[i];
+        }
+    }
+}
+
+// dst[i] += value
+template <typename T>
+void add(std::span<T> dst, std::type_identity_t<T> value) {
+    if constexpr (traits<T>::is_fixed && !checked_arithmetic) {
+        for (auto& x : dst) {
+            x.v += value.v;
+        }
+    } else {
+        for (auto& x : dst) {
+            x += value;
+        }
+    }
+}
+
+// dst[i] = dst[i] * factor: умножение в расширенном типе и сдвиг на K,
+// результат бит в бит как у скалярного operator*.
+template <typename T>
+void multiply(std::span<T> dst, std::type_identity_t<T> factor) {
+    if constexpr (traits<T>::is_fixed && !checked_arithmetic) {
+        using Wide = typename traits<T>::Wide;
+        const Wide f = factor.v;
+        for (auto& x : dst) {
+            x.v = static_cast<typename T::StorageType>((static_cast<Wide>(x.v) * f) >> traits<T>::frac_bits);
+        }
+    } else {
+        for (auto& x : dst) {
+            x *= factor;
+        }
+    }
+}
+
+// dst[i] = dst[i] * src[i]
+template <typename T>
+void multiply(std::span<T> dst, std::type_identity_t<std::span<const T>> src) {
+    if constexpr (traits<T>::is_fixed && !checked_arithmetic) {
+        using Wide = typename traits<T>::Wide;
+        for (size_t i = 0; i < dst.size(); ++i) {
+            dst[i].v = static_cast<typename T::StorageType>(
+                (static_cast<Wide>(dst[i].v) * static_cast<Wide>(src[i].v)) >> traits<T>::frac_bits);
+        }
+    } else {
+        for (size_t i = 0; i < dst.size(); ++i) {
+            dst[i] *= src[i];
+        }
+    }
+}
+
+// dst[i] = dst[i] / divisor через одно деление: обратная величина берётся с
+// таким запасом дробных бит, чтобы занять весь расширенный тип, но не
+// переполнить произведение на любое значение StorageType; затем умножение и
+// сдвиг. Для FixedPoint при |divisor| >= 1 результат отличается от
+// поэлементного деления не больше чем на единицу младшего разряда (обратная
+// величина усечена, сдвиг округляет вниз, деление — к нулю).
+// В режиме проверок делим поэлементно, чтобы события попали в счётчики.
+template <typename T>
+void scale_by_reciprocal(std::span<T> dst, std::type_identity_t<T> divisor) {
+    assert(divisor != T(0) && "scale_by_reciprocal: деление на ноль");
+    if constexpr (traits<T>::is_fixed && checked_arithmetic) {
+        for (auto& x : dst) {
+            x /= divisor;
+        }
+    } else if constexpr (traits<T>::is_fixed) {
+        using R = typename traits<T>::Reciprocal;
+        size_t divisor_bits = 0;
+        for (R m = divisor.v < 0 ? -static_cast<R>(divisor.v) : static_cast<R>(divisor.v); m != 0; m >>= 1) {
+            ++divisor_bits;
+        }
+        const size_t shift = sizeof(R) * 8 + divisor_bits - traits<T>::storage_bits - traits<T>::frac_bits - 2;
+        const R r = (R(1) << (traits<T>::frac_bits + shift)) / divisor.v;
+        for (auto& x : dst) {
+            x.v = static_cast<typename T::StorageType>((static_cast<R>(x.v) * r) >> shift);
+        }
+    } else {
+        const T r = T(1) / divisor;
+        for (auto& x : dst) {
+            x *= r;
+        }
+    }
+}
+
+// mask[i] = 0xff, если values[i] < threshold, иначе 0.
+template <typename T>
+void mask_less(std::span<const T> values, std::type_identity_t<T> threshold, std::span<uint8_t> mask) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        if constexpr (traits<T>::is_fixed) {
+            mask[i] = -static_cast<uint8_t>(values[i].v < threshold.v);
+        } else {
+            mask[i] = -static_cast<uint8_t>(values[i] < threshold);
+        }
+    }
+}
+
+// mask[i] = 0xff, если values[i] > threshold, иначе 0.
+template <typename T>
+void mask_greater(std::span<const T> values, std::type_identity_t<T> threshold, std::span<uint8_t> mask) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        if constexpr (traits<T>::is_fixed) {
+            mask[i] = -static_cast<uint8_t>(values[i].v > threshold.v);
+        } else {
+            mask[i] = -static_cast<uint8_t>(values[i] > threshold);
+        }
+    }
+}
+
+// out[i] = double(values[i]); умножение на 2^-K точно совпадает с делением
+// в operator double.
+template <typename T>
+void to_double(std::span<const T> values, std::span<double> out) {
+    if constexpr (traits<T>::is_fixed) {
+        constexpr double scale = 1.0 / (1ULL << traits<T>::frac_bits);
+        for (size_t i = 0; i < values.size(); ++i) {
+            out[i] = static_cast<double>(values[i].v) * scale;
+        }
+    } else {
+        for (size_t i = 0; i < values.size(); ++i) {
+            out[i] = static_cast<double>(values[i]);
+        }
+    }
+}
+
+}
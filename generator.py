@@ -4,7 +4,9 @@ import itertools
 
 cpp_template = """
 #include "FluidSimulator.h"
+#include "SimulationServer.h"
 #include <cstdlib>
+#include <stdexcept>
 #include <unordered_map>
 #include <variant>
 #include <string>
@@ -19,20 +21,115 @@ void replaceBrackets(std::string& input) {
     }
 }
 
+// Число целиком, без хвоста и знака минус; иначе std::invalid_argument.
+size_t toSize(const std::string& text) {
+    size_t used = 0;
+    unsigned long value = std::stoul(text, &used);
+    if (used != text.size() || text.find('-') != std::string::npos) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+double toDouble(const std::string& text) {
+    size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+void printUsage() {
+    std::cerr << "Использование: project2 --p-type=T --v-type=T --v-flow-type=T --size=\\"N, M\\" [параметры]\\n"
+                 "  --ticks=T --save-interval=K --input=path --output=path\\n"
+                 "  --steady-window=W --steady-eps=E --steady-moves=K --time-limit=S\\n"
+                 "  --pipeline=K --pipeline-band=R --incremental-flow --memory-report\\n"
+                 "  --frame-ring=/имя --frame-ring-slots=K --frame-ring-fields\\n"
+                 "  --snapshot=path --snapshot-interval=K --resume=path\\n"
+                 "  --history --history-limit=K --rewind=K --replay-ticks=R --replay-g=G --replay-rho=C:RHO --replay-seed=S\\n"
+                 "  --serve=path --serve-workers=K\\n";
+}
+
 using FluidSimulatorVariant = std::variant<{{types}}>;
 
+// Симуляторы строятся прямо в памяти вектора: временные копии в списке
+// инициализации не помещаются на стек.
+template<typename... Simulators>
+std::vector<std::variant<Simulators...>> makeSimulators() {
+    std::vector<std::variant<Simulators...>> arr;
+    arr.reserve(sizeof...(Simulators));
+    (arr.emplace_back(std::in_place_type<Simulators>), ...);
+    return arr;
+}
+
 int main(int argc, char* argv[]) {
     std::unordered_map<std::string, int> params = { {{params}} };
-    std::vector<FluidSimulatorVariant> arr = { {{types_vec}} };
+    std::vector<FluidSimulatorVariant> arr = makeSimulators<{{types}}>();
 
     std::string p_type, v_type, v_flow_type, size;
+    SimulationConfig config;
+    bool memory_report = false;
+    std::string serve_path;
+    size_t serve_workers = std::thread::hardware_concurrency();
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
-        if (arg.find("--p-type=") == 0) p_type = arg.substr(9);
-        else if (arg.find("--v-type=") == 0) v_type = arg.substr(9);
-        else if (arg.find("--v-flow-type=") == 0) v_flow_type = arg.substr(14);
-        else if (arg.find("--size=") == 0) size = arg.substr(7);
+        try {
+            if (arg.find("--p-type=") == 0) p_type = arg.substr(9);
+            else if (arg.find("--v-type=") == 0) v_type = arg.substr(9);
+            else if (arg.find("--v-flow-type=") == 0) v_flow_type = arg.substr(14);
+            else if (arg.find("--size=") == 0) size = arg.substr(7);
+            else if (arg.find("--pipeline=") == 0) config.pipeline_threads = toSize(arg.substr(11));
+            else if (arg.find("--pipeline-band=") == 0) config.pipeline_band = toSize(arg.substr(16));
+            else if (arg == "--incremental-flow") config.incremental_flow = true;
+            else if (arg == "--memory-report") memory_report = true;
+            else if (arg.find("--ticks=") == 0) config.T = toSize(arg.substr(8));
+            else if (arg.find("--save-interval=") == 0) config.save_interval = toSize(arg.substr(16));
+            else if (arg.find("--input=") == 0) config.input_file = arg.substr(8);
+            else if (arg.find("--output=") == 0) config.output_file = arg.substr(9);
+            else if (arg.find("--steady-window=") == 0) config.steady_window = toSize(arg.substr(16));
+            else if (arg.find("--steady-eps=") == 0) config.steady_eps = toDouble(arg.substr(13));
+            else if (arg.find("--steady-moves=") == 0) config.steady_moves = toSize(arg.substr(15));
+            else if (arg.find("--time-limit=") == 0) config.time_limit = toDouble(arg.substr(13));
+            else if (arg.find("--frame-ring=") == 0) config.frame_ring = arg.substr(13);
+            else if (arg.find("--frame-ring-slots=") == 0) config.frame_ring_slots = toSize(arg.substr(19));
+            else if (arg == "--frame-ring-fields") config.frame_ring_fields = true;
+            else if (arg.find("--snapshot=") == 0) config.snapshot_file = arg.substr(11);
+            else if (arg.find("--snapshot-interval=") == 0) config.snapshot_interval = toSize(arg.substr(20));
+            else if (arg.find("--resume=") == 0) config.resume_file = arg.substr(9);
+            else if (arg == "--history") config.history = true;
+            else if (arg.find("--history-limit=") == 0) config.history_limit = toSize(arg.substr(16));
+            else if (arg.find("--rewind=") == 0) config.rewind_to = toSize(arg.substr(9));
+            else if (arg.find("--replay-ticks=") == 0) config.replay_ticks = toSize(arg.substr(15));
+            else if (arg.find("--replay-g=") == 0) config.replay_g = toDouble(arg.substr(11));
+            else if (arg.find("--replay-rho=") == 0 && arg.size() > 15) config.replay_rho.emplace_back(arg[13], toDouble(arg.substr(15)));
+            else if (arg.find("--replay-seed=") == 0) config.replay_seed = toSize(arg.substr(14));
+            else if (arg.find("--serve=") == 0) serve_path = arg.substr(8);
+            else if (arg.find("--serve-workers=") == 0) serve_workers = toSize(arg.substr(16));
+        } catch (const std::exception&) {
+            std::cerr << "Неверное значение параметра: " << arg << "\\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (memory_report) {
+        std::vector<std::string> names(params.size());
+        for (const auto& [name, index] : params) {
+            names[index] = name;
+        }
+        for (size_t i = 0; i < names.size(); ++i) {
+            std::visit([&](auto& simulator) {
+                std::cout << names[i] << ": " << simulator.bytes_per_cell() << " байт на клетку\\n";
+            }, arr[i]);
+        }
+        return 0;
+    }
+
+    if (!serve_path.empty()) {
+        SimulationServer<FluidSimulatorVariant> server(arr, params);
+        return server.serve(serve_path, serve_workers);
     }
 
     std::string args_str = p_type + " " + v_type + " " + v_flow_type + ", " + size;
@@ -44,16 +141,22 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    size_t T = 2500;
-    size_t tick_save = 50;
-    std::string input_file = "../input.json";
     std::visit([&](auto& simulator) { 
-        simulator.run_simulation(T, tick_save, input_file); 
+        simulator.run_simulation(config); 
     }, arr[it->second]);
     return 0;
 }
 """
 
+bench_template = """
+#include "Benchmark.h"
+
+int main(int argc, char* argv[]) {
+    std::vector<BenchTarget> targets = { {{bench_targets}} };
+    return run_benchmarks(targets, argc, argv);
+}
+"""
+
 def normalize_fast_fixed(input_string):
     """Replace FAST_FIXED(N, M) -> FAST_FIXED<N, M>"""
     return re.sub(r'FAST_FIXED\((\d+),\s*(\d+)\)', r'FAST_FIXED<\1,\2>', input_string)
@@ -80,12 +183,15 @@ def create_combinations(types, sizes):
     ]
 
 def generate_code(types, sizes):
-    """Generate variant, vector, and params."""
+    """Generate variant, params and bench targets."""
     type_combinations = create_combinations(types, sizes)
     types_variant = ", ".join(f"Simulator<{t}>" for t in type_combinations)
-    types_vec = ", ".join(f"Simulator<{t}>()" for t in type_combinations)
     params_map = ", ".join(f'{{"{t}", {i}}}' for i, t in enumerate(type_combinations))
-    return types_variant, types_vec, params_map
+    bench_targets = ", ".join(
+        f'{{"{t}", {size[0]}, {size[1]}, &run_bench_case<Simulator<{t}>>, &check_batch_types<{t}>}}'
+        for t, size in zip(type_combinations, (s for _ in itertools.product(types, repeat=3) for s in sizes))
+    )
+    return types_variant, params_map, bench_targets
 
 if len(sys.argv) < 3:
     print("Usage: python generate_code.py <TYPES> <SIZES>")
@@ -97,10 +203,13 @@ sizes_value = sys.argv[2]
 parsed_types = parse_types(types_value)
 parsed_sizes = parse_string(sizes_value)
 
-variant, vec, params = generate_code(parsed_types, parsed_sizes)
-rendered_code = cpp_template.replace("{{types}}", variant).replace("{{types_vec}}", vec).replace("{{params}}", params)
+variant, params, bench_targets = generate_code(parsed_types, parsed_sizes)
+rendered_code = cpp_template.replace("{{types}}", variant).replace("{{params}}", params)
 
 with open("main.cpp", "w") as cpp_file:
     cpp_file.write(rendered_code)
 
-print("Generated main.cpp")
\ No newline at end of file
+with open("bench.cpp", "w") as cpp_file:
+    cpp_file.write(bench_template.replace("{{bench_targets}}", bench_targets))
+
+print("Generated main.cpp, bench.cpp")
\ No newline at end of file
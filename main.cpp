@@ -1,6 +1,8 @@
 
 #include "FluidSimulator.h"
+#include "SimulationServer.h"
 #include <cstdlib>
+#include <stdexcept>
 #include <unordered_map>
 #include <variant>
 #include <string>
@@ -15,20 +17,115 @@ void replaceBrackets(std::string& input) {
     }
 }
 
+// Число целиком, без хвоста и знака минус; иначе std::invalid_argument.
+size_t toSize(const std::string& text) {
+    size_t used = 0;
+    unsigned long value = std::stoul(text, &used);
+    if (used != text.size() || text.find('-') != std::string::npos) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+double toDouble(const std::string& text) {
+    size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+void printUsage() {
+    std::cerr << "Использование: project2 --p-type=T --v-type=T --v-flow-type=T --size=\"N, M\" [параметры]\n"
+                 "  --ticks=T --save-interval=K --input=path --output=path\n"
+                 "  --steady-window=W --steady-eps=E --steady-moves=K --time-limit=S\n"
+                 "  --pipeline=K --pipeline-band=R --incremental-flow --memory-report\n"
+                 "  --frame-ring=/имя --frame-ring-slots=K --frame-ring-fields\n"
+                 "  --snapshot=path --snapshot-interval=K --resume=path\n"
+                 "  --history --history-limit=K --rewind=K --replay-ticks=R --replay-g=G --replay-rho=C:RHO --replay-seed=S\n"
+                 "  --serve=path --serve-workers=K\n";
+}
+
 using FluidSimulatorVariant = std::variant<Simulator<float, float, float, 36, 84>, Simulator<float, float, float, 14, 5>, Simulator<float, float, FAST_FIXED<13,7>, 36, 84>, Simulator<float, float, FAST_FIXED<13,7>, 14, 5>, Simulator<float, float, FIXED<64,15>, 36, 84>, Simulator<float, float, FIXED<64,15>, 14, 5>, Simulator<float, FAST_FIXED<13,7>, float, 36, 84>, Simulator<float, FAST_FIXED<13,7>, float, 14, 5>, Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<float, FIXED<64,15>, float, 36, 84>, Simulator<float, FIXED<64,15>, float, 14, 5>, Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<float, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<float, FIXED<64,15>, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, float, float, 36, 84>, Simulator<FAST_FIXED<13,7>, float, float, 14, 5>, Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, float, float, 36, 84>, Simulator<FIXED<64,15>, float, float, 14, 5>, Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, float, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, float, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, float, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, float, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5>>;
 
+// Симуляторы строятся прямо в памяти вектора: временные копии в списке
+// инициализации не помещаются на стек.
+template<typename... Simulators>
+std::vector<std::variant<Simulators...>> makeSimulators() {
+    std::vector<std::variant<Simulators...>> arr;
+    arr.reserve(sizeof...(Simulators));
+    (arr.emplace_back(std::in_place_type<Simulators>), ...);
+    return arr;
+}
+
 int main(int argc, char* argv[]) {
     std::unordered_map<std::string, int> params = { {"float, float, float, 36, 84", 0}, {"float, float, float, 14, 5", 1}, {"float, float, FAST_FIXED<13,7>, 36, 84", 2}, {"float, float, FAST_FIXED<13,7>, 14, 5", 3}, {"float, float, FIXED<64,15>, 36, 84", 4}, {"float, float, FIXED<64,15>, 14, 5", 5}, {"float, FAST_FIXED<13,7>, float, 36, 84", 6}, {"float, FAST_FIXED<13,7>, float, 14, 5", 7}, {"float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 8}, {"float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 9}, {"float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 10}, {"float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 11}, {"float, FIXED<64,15>, float, 36, 84", 12}, {"float, FIXED<64,15>, float, 14, 5", 13}, {"float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 14}, {"float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 15}, {"float, FIXED<64,15>, FIXED<64,15>, 36, 84", 16}, {"float, FIXED<64,15>, FIXED<64,15>, 14, 5", 17}, {"FAST_FIXED<13,7>, float, float, 36, 84", 18}, {"FAST_FIXED<13,7>, float, float, 14, 5", 19}, {"FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84", 20}, {"FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5", 21}, {"FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84", 22}, {"FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5", 23}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84", 24}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5", 25}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 26}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 27}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 28}, {"FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 29}, {"FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84", 30}, {"FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5", 31}, {"FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 32}, {"FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 33}, {"FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84", 34}, {"FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5", 35}, {"FIXED<64,15>, float, float, 36, 84", 36}, {"FIXED<64,15>, float, float, 14, 5", 37}, {"FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84", 38}, {"FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5", 39}, {"FIXED<64,15>, float, FIXED<64,15>, 36, 84", 40}, {"FIXED<64,15>, float, FIXED<64,15>, 14, 5", 41}, {"FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84", 42}, {"FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5", 43}, {"FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84", 44}, {"FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5", 45}, {"FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84", 46}, {"FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5", 47}, {"FIXED<64,15>, FIXED<64,15>, float, 36, 84", 48}, {"FIXED<64,15>, FIXED<64,15>, float, 14, 5", 49}, {"FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84", 50}, {"FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5", 51}, {"FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84", 52}, {"FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5", 53} };
-    std::vector<FluidSimulatorVariant> arr = { Simulator<float, float, float, 36, 84>(), Simulator<float, float, float, 14, 5>(), Simulator<float, float, FAST_FIXED<13,7>, 36, 84>(), Simulator<float, float, FAST_FIXED<13,7>, 14, 5>(), Simulator<float, float, FIXED<64,15>, 36, 84>(), Simulator<float, float, FIXED<64,15>, 14, 5>(), Simulator<float, FAST_FIXED<13,7>, float, 36, 84>(), Simulator<float, FAST_FIXED<13,7>, float, 14, 5>(), Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>(), Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>(), Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>(), Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>(), Simulator<float, FIXED<64,15>, float, 36, 84>(), Simulator<float, FIXED<64,15>, float, 14, 5>(), Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>(), Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>(), Simulator<float, FIXED<64,15>, FIXED<64,15>, 36, 84>(), Simulator<float, FIXED<64,15>, FIXED<64,15>, 14, 5>(), Simulator<FAST_FIXED<13,7>, float, float, 36, 84>(), Simulator<FAST_FIXED<13,7>, float, float, 14, 5>(), Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84>(), Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5>(), Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84>(), Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>(), Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84>(), Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5>(), Simulator<FIXED<64,15>, float, float, 36, 84>(), Simulator<FIXED<64,15>, float, float, 14, 5>(), Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84>(), Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5>(), Simulator<FIXED<64,15>, float, FIXED<64,15>, 36, 84>(), Simulator<FIXED<64,15>, float, FIXED<64,15>, 14, 5>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>(), Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>(), Simulator<FIXED<64,15>, FIXED<64,15>, float, 36, 84>(), Simulator<FIXED<64,15>, FIXED<64,15>, float, 14, 5>(), Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>(), Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>(), Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84>(), Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5>() };
+    std::vector<FluidSimulatorVariant> arr = makeSimulators<Simulator<float, float, float, 36, 84>, Simulator<float, float, float, 14, 5>, Simulator<float, float, FAST_FIXED<13,7>, 36, 84>, Simulator<float, float, FAST_FIXED<13,7>, 14, 5>, Simulator<float, float, FIXED<64,15>, 36, 84>, Simulator<float, float, FIXED<64,15>, 14, 5>, Simulator<float, FAST_FIXED<13,7>, float, 36, 84>, Simulator<float, FAST_FIXED<13,7>, float, 14, 5>, Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<float, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<float, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<float, FIXED<64,15>, float, 36, 84>, Simulator<float, FIXED<64,15>, float, 14, 5>, Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<float, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<float, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<float, FIXED<64,15>, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, float, float, 36, 84>, Simulator<FAST_FIXED<13,7>, float, float, 14, 5>, Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, float, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, float, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, float, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, float, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<FAST_FIXED<13,7>, FIXED<64,15>, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, float, float, 36, 84>, Simulator<FIXED<64,15>, float, float, 14, 5>, Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, float, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, float, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, float, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, float, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, FAST_FIXED<13,7>, FIXED<64,15>, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, float, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, float, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, FAST_FIXED<13,7>, 14, 5>, Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 36, 84>, Simulator<FIXED<64,15>, FIXED<64,15>, FIXED<64,15>, 14, 5>>();
 
     std::string p_type, v_type, v_flow_type, size;
+    SimulationConfig config;
+    bool memory_report = false;
+    std::string serve_path;
+    size_t serve_workers = std::thread::hardware_concurrency();
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
-        if (arg.find("--p-type=") == 0) p_type = arg.substr(9);
-        else if (arg.find("--v-type=") == 0) v_type = arg.substr(9);
-        else if (arg.find("--v-flow-type=") == 0) v_flow_type = arg.substr(14);
-        else if (arg.find("--size=") == 0) size = arg.substr(7);
+        try {
+            if (arg.find("--p-type=") == 0) p_type = arg.substr(9);
+            else if (arg.find("--v-type=") == 0) v_type = arg.substr(9);
+            else if (arg.find("--v-flow-type=") == 0) v_flow_type = arg.substr(14);
+            else if (arg.find("--size=") == 0) size = arg.substr(7);
+            else if (arg.find("--pipeline=") == 0) config.pipeline_threads = toSize(arg.substr(11));
+            else if (arg.find("--pipeline-band=") == 0) config.pipeline_band = toSize(arg.substr(16));
+            else if (arg == "--incremental-flow") config.incremental_flow = true;
+            else if (arg == "--memory-report") memory_report = true;
+            else if (arg.find("--ticks=") == 0) config.T = toSize(arg.substr(8));
+            else if (arg.find("--save-interval=") == 0) config.save_interval = toSize(arg.substr(16));
+            else if (arg.find("--input=") == 0) config.input_file = arg.substr(8);
+            else if (arg.find("--output=") == 0) config.output_file = arg.substr(9);
+            else if (arg.find("--steady-window=") == 0) config.steady_window = toSize(arg.substr(16));
+            else if (arg.find("--steady-eps=") == 0) config.steady_eps = toDouble(arg.substr(13));
+            else if (arg.find("--steady-moves=") == 0) config.steady_moves = toSize(arg.substr(15));
+            else if (arg.find("--time-limit=") == 0) config.time_limit = toDouble(arg.substr(13));
+            else if (arg.find("--frame-ring=") == 0) config.frame_ring = arg.substr(13);
+            else if (arg.find("--frame-ring-slots=") == 0) config.frame_ring_slots = toSize(arg.substr(19));
+            else if (arg == "--frame-ring-fields") config.frame_ring_fields = true;
+            else if (arg.find("--snapshot=") == 0) config.snapshot_file = arg.substr(11);
+            else if (arg.find("--snapshot-interval=") == 0) config.snapshot_interval = toSize(arg.substr(20));
+            else if (arg.find("--resume=") == 0) config.resume_file = arg.substr(9);
+            else if (arg == "--history") config.history = true;
+            else if (arg.find("--history-limit=") == 0) config.history_limit = toSize(arg.substr(16));
+            else if (arg.find("--rewind=") == 0) config.rewind_to = toSize(arg.substr(9));
+            else if (arg.find("--replay-ticks=") == 0) config.replay_ticks = toSize(arg.substr(15));
+            else if (arg.find("--replay-g=") == 0) config.replay_g = toDouble(arg.substr(11));
+            else if (arg.find("--replay-rho=") == 0 && arg.size() > 15) config.replay_rho.emplace_back(arg[13], toDouble(arg.substr(15)));
+            else if (arg.find("--replay-seed=") == 0) config.replay_seed = toSize(arg.substr(14));
+            else if (arg.find("--serve=") == 0) serve_path = arg.substr(8);
+            else if (arg.find("--serve-workers=") == 0) serve_workers = toSize(arg.substr(16));
+        } catch (const std::exception&) {
+            std::cerr << "Неверное значение параметра: " << arg << "\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (memory_report) {
+        std::vector<std::string> names(params.size());
+        for (const auto& [name, index] : params) {
+            names[index] = name;
+        }
+        for (size_t i = 0; i < names.size(); ++i) {
+            std::visit([&](auto& simulator) {
+                std::cout << names[i] << ": " << simulator.bytes_per_cell() << " байт на клетку\n";
+            }, arr[i]);
+        }
+        return 0;
+    }
+
+    if (!serve_path.empty()) {
+        SimulationServer<FluidSimulatorVariant> server(arr, params);
+        return server.serve(serve_path, serve_workers);
     }
 
     std::string args_str = p_type + " " + v_type + " " + v_flow_type + ", " + size;
@@ -40,11 +137,8 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    size_t T = 2500;
-    size_t tick_save = 50;
-    std::string input_file = "../input.json";
     std::visit([&](auto& simulator) { 
-        simulator.run_simulation(T, tick_save, input_file); 
+        simulator.run_simulation(config); 
     }, arr[it->second]);
     return 0;
 }
@@ -0,0 +1,71 @@
+#include "FrameRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Читатель кольца кадров: печатает последний кадр, пока симулятор пишет новые.
+int main(int argc, char* argv[]) {
+    std::string name;
+    size_t interval_ms = 100;
+    double idle_limit = 5;
+    size_t max_frames = 0;
+
+    const char* usage = "Использование: fluid_view /имя [--interval=мс] [--idle=с] [--frames=K]";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg.find("--interval=") == 0) interval_ms = std::stoul(arg.substr(11));
+            else if (arg.find("--idle=") == 0) idle_limit = std::stod(arg.substr(7));
+            else if (arg.find("--frames=") == 0) max_frames = std::stoul(arg.substr(9));
+            else name = arg;
+        } catch (const std::exception&) {
+            std::cerr << "Неверное значение параметра: " << arg << "\n" << usage << std::endl;
+            return 1;
+        }
+    }
+    if (name.empty()) {
+        std::cout << usage << std::endl;
+        return 1;
+    }
+
+    FrameRingReader reader;
+    if (!reader.attach(name)) {
+        return 1;
+    }
+
+    Frame frame;
+    uint64_t last = 0;
+    size_t shown = 0;
+    auto last_new = std::chrono::steady_clock::now();
+    while (max_frames == 0 || shown < max_frames) {
+        if (reader.read_latest(frame) && frame.number != last) {
+            std::cout << "кадр " << frame.number << ", такт " << frame.tick;
+            if (last != 0 && frame.number > last + 1) {
+                std::cout << " (пропущено " << frame.number - last - 1 << ")";
+            }
+            if (!frame.pressure.empty()) {
+                auto [lo, hi] = std::minmax_element(frame.pressure.begin(), frame.pressure.end());
+                std::cout << ", p: [" << *lo << ", " << *hi << "]";
+            }
+            if (!frame.speed.empty()) {
+                std::cout << ", max |v|: " << *std::max_element(frame.speed.begin(), frame.speed.end());
+            }
+            std::cout << "\n";
+            for (size_t x = 0; x < frame.rows; ++x) {
+                std::cout.write(frame.cells.data() + x * frame.cols, frame.cols) << "\n";
+            }
+            std::cout.flush();
+            last = frame.number;
+            ++shown;
+            last_new = std::chrono::steady_clock::now();
+        } else if (std::chrono::duration<double>(std::chrono::steady_clock::now() - last_new).count() > idle_limit) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    return 0;
+}